@@ -1,33 +1,193 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L /* pthreads and sysconf() under -ansi */
+#endif
+#if defined(__linux__) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE         /* madvise() and MADV_HUGEPAGE, which glibc hides with _POSIX_C_SOURCE alone */
+#endif
 #ifdef _WINDOWS
 #define _CRTDBG_MAP_ALLOC
 #include <crtdbg.h>
 #endif
 #include "leptjson.h"
 #include <assert.h>  /* assert() */
-#include <errno.h>   /* errno, ERANGE */
-#include <math.h>    /* HUGE_VAL */
-#include <stdio.h>   /* sprintf() */
-#include <stdlib.h>  /* NULL, malloc(), realloc(), free(), strtod() */
-#include <string.h>  /* memcpy() */
+#include <math.h>    /* ldexp(), HUGE_VAL */
+#include <stdio.h>   /* sprintf(), fopen(), fread() */
+#include <stdlib.h>  /* NULL, malloc(), realloc(), free() */
+#include <string.h>  /* memcpy(), memcmp(), memset(), strlen() */
+
+#if !defined(LEPT_SSE2) && !defined(LEPT_NO_SSE2)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LEPT_SSE2
+#endif
+#endif
+
+#ifdef LEPT_SSE2
+#include <emmintrin.h> /* _mm_*() */
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>    /* _BitScanForward() */
+#endif
+
+#if !defined(LEPT_NO_THREADS)
+#if defined(_WIN32)
+#define LEPT_WIN32_THREADS
+#include <windows.h>   /* CreateThread() */
+#elif defined(__unix__) || defined(__APPLE__)
+#define LEPT_PTHREADS
+#include <pthread.h>   /* pthread_create() */
+#include <unistd.h>    /* sysconf() */
+#endif
+#endif
+
+#if !defined(LEPT_NO_MMAP)
+#if defined(_WIN32)
+#define LEPT_WIN32_MMAP
+#include <windows.h>   /* CreateFileMappingA() */
+#elif defined(__unix__) || defined(__APPLE__)
+#define LEPT_POSIX_MMAP
+#include <fcntl.h>     /* open() */
+#include <sys/mman.h>  /* mmap(), posix_madvise() */
+#include <sys/stat.h>  /* fstat() */
+#include <unistd.h>    /* close() */
+#endif
+#endif
 
 #ifndef LEPT_PARSE_STACK_INIT_SIZE
 #define LEPT_PARSE_STACK_INIT_SIZE 256
 #endif
 
+#ifndef LEPT_DECIMAL_MAX_DIGITS
+#define LEPT_DECIMAL_MAX_DIGITS 800
+#endif
+
+#ifndef LEPT_ARENA_BLOCK_SIZE
+#define LEPT_ARENA_BLOCK_SIZE 4096
+#endif
+
+#ifndef LEPT_PARALLEL_MIN_SIZE
+#define LEPT_PARALLEL_MIN_SIZE 65536 /* bytes of input worth a thread */
+#endif
+
+#ifndef LEPT_FILE_READ_SIZE
+#define LEPT_FILE_READ_SIZE 65536 /* bytes per fread() when a file cannot be mapped */
+#endif
+
+#ifndef LEPT_OBJECT_HASH_MIN_SIZE
+#define LEPT_OBJECT_HASH_MIN_SIZE 16 /* members from which a parsed object gets a hash index */
+#endif
+
 #ifndef LEPT_PARSE_STRINGIFY_INIT_SIZE
 #define LEPT_PARSE_STRINGIFY_INIT_SIZE 256
 #endif
 
-#define EXPECT(c, ch)       do { assert(*c->json == (ch)); c->json++; } while(0)
+#define EXPECT(c, ch)       do { assert(PEEK(c) == (ch)); c->json++; } while(0)
+#define PEEK(c)             ((c)->json != (c)->end ? *(c)->json : '\0')
 #define ISDIGIT(ch)         ((ch) >= '0' && (ch) <= '9')
 #define ISDIGIT1TO9(ch)     ((ch) >= '1' && (ch) <= '9')
 #define PUTC(c, ch)         do { *(char*)lept_context_push(c, sizeof(char)) = (ch); } while(0)
 #define PUTS(c, s, len)     memcpy(lept_context_push(c, len), s, len)
 
+static void* lept_std_alloc(void* user, size_t size) { (void)user; return malloc(size); }
+static void* lept_std_realloc(void* user, void* p, size_t size) { (void)user; return realloc(p, size); }
+static void lept_std_free(void* user, void* p) { (void)user; free(p); }
+
+static const lept_allocator lept_std_allocator = { lept_std_alloc, lept_std_realloc, lept_std_free, NULL };
+
+#define LEPT_ALLOCATOR(a)           ((a) != NULL ? (a) : &lept_std_allocator)
+/* the parentheses keep malloc debugging macros such as _CRTDBG_MAP_ALLOC from expanding the member names */
+#define LEPT_MALLOC(a, size)        (((a)->alloc)((a)->user, size))
+#define LEPT_REALLOC(a, p, size)    (((a)->realloc)((a)->user, p, size))
+#define LEPT_FREE(a, p)             (((a)->free)((a)->user, p))
+
+/* lept_value::flags */
+#define LEPT_SHARED_STRING  0x1 /* u.s.s, or the member keys of an object, point into the input and are not freed */
+#define LEPT_INT64          0x2 /* number stored in u.i */
+#define LEPT_ARENA          0x4 /* u.s.s, u.a.e, or u.o.m and its keys belong to a document arena and are not freed */
+#define LEPT_HASHED         0x8 /* u.o.m is followed by a hash index of the keys */
+#define LEPT_INLINE_STRING  0x10 /* u.c holds the string, its length is flags >> LEPT_INLINE_SHIFT */
+#define LEPT_LAZY_NUMBER    0x20 /* number not converted yet, u.s spans its source text */
+#define LEPT_LAZY_STRING    0x40 /* u.s spans the string in the input, which has no escapes and no terminator */
+
+#define LEPT_PARSE_LAZY_FLAGS   (LEPT_PARSE_LAZY_NUMBER_FLAG | LEPT_PARSE_LAZY_STRING_FLAG)
+
+#define LEPT_INLINE_SHIFT   8
+#define LEPT_INLINE_MAX     (sizeof(((lept_value*)0)->u.c) - 1) /* longest string stored inline */
+
+#ifndef LEPT_LENGTH_MAX
+#define LEPT_LENGTH_MAX     ((lept_length)-1) /* longest string, largest array or object, at most that of lept_length */
+#endif
+
+/* Bump allocator of a document, blocks are only freed all together */
+typedef struct lept_arena_block {
+    struct lept_arena_block* next;
+    size_t size;
+}lept_arena_block;
+
+typedef struct {
+    lept_arena_block* blocks;   /* most recent first */
+    char* p, *end;              /* free space in blocks */
+    const lept_allocator* allocator;
+}lept_arena;
+
+#define LEPT_ARENA_ALIGN(n) (((n) + sizeof(double) - 1) & ~(sizeof(double) - 1))
+
+static void* lept_arena_alloc(lept_arena* a, size_t size) {
+    void* ret;
+    size = LEPT_ARENA_ALIGN(size);
+    if ((size_t)(a->end - a->p) < size) {
+        size_t block = a->blocks != NULL ? a->blocks->size * 2 : LEPT_ARENA_BLOCK_SIZE;
+        lept_arena_block* b;
+        while (block < size)
+            block *= 2;
+        b = (lept_arena_block*)LEPT_MALLOC(a->allocator, LEPT_ARENA_ALIGN(sizeof(lept_arena_block)) + block);
+        b->next = a->blocks;
+        b->size = block;
+        a->blocks = b;
+        a->p = (char*)b + LEPT_ARENA_ALIGN(sizeof(lept_arena_block));
+        a->end = a->p + block;
+    }
+    ret = a->p;
+    a->p += size;
+    return ret;
+}
+
+/* Keeps only the largest block for the next document, which after a batch need not be the most recent one */
+static void lept_arena_reset(lept_arena* a) {
+    lept_arena_block* b, *keep = a->blocks;
+    if (keep == NULL)
+        return;
+    for (b = keep->next; b != NULL; b = b->next)
+        if (b->size > keep->size)
+            keep = b;
+    while ((b = a->blocks) != NULL) {
+        a->blocks = b->next;
+        if (b != keep)
+            LEPT_FREE(a->allocator, b);
+    }
+    keep->next = NULL;
+    a->blocks = keep;
+    a->p = (char*)keep + LEPT_ARENA_ALIGN(sizeof(lept_arena_block));
+    a->end = a->p + keep->size;
+}
+
+static void lept_arena_free(lept_arena* a) {
+    lept_arena_block* b;
+    while ((b = a->blocks) != NULL) {
+        a->blocks = b->next;
+        LEPT_FREE(a->allocator, b);
+    }
+    a->p = a->end = NULL;
+}
+
 typedef struct {
-    const char* json;
+    const char* json, *end;
     char* stack;
     size_t size, top;
+    int insitu;
+    unsigned lazy;      /* LEPT_PARSE_LAZY_*_FLAG bits: values left unconverted, pointing into the input */
+    struct lept_index* index; /* stage 1 result, or NULL to scan */
+    lept_arena* arena;  /* storage of the parsed values, or NULL for the allocator */
+    const lept_allocator* allocator;
 }lept_context;
 
 static void* lept_context_push(lept_context* c, size_t size) {
@@ -38,7 +198,7 @@ static void* lept_context_push(lept_context* c, size_t size) {
             c->size = LEPT_PARSE_STACK_INIT_SIZE;
         while (c->top + size >= c->size)
             c->size += c->size >> 1;  /* c->size * 1.5 */
-        c->stack = (char*)realloc(c->stack, c->size);
+        c->stack = (char*)LEPT_REALLOC(c->allocator, c->stack, c->size);
     }
     ret = c->stack + c->top;
     c->top += size;
@@ -50,55 +210,803 @@ static void* lept_context_pop(lept_context* c, size_t size) {
     return c->stack + (c->top -= size);
 }
 
+/* Storage of a parsed string, key, element or member array */
+static void* lept_context_alloc(lept_context* c, size_t size) {
+    return c->arena != NULL ? lept_arena_alloc(c->arena, size) : LEPT_MALLOC(c->allocator, size);
+}
+
+static void lept_context_free(lept_context* c, void* p) {
+    if (c->arena == NULL)
+        LEPT_FREE(c->allocator, p);
+}
+
+/*
+ * Hash index of an object: a power-of-two table of member index + 1 (0 for empty) with linear probing, stored right
+ * after the members. Its capacity follows from the member count.
+ */
+static size_t lept_hash_capacity(size_t size) {
+    size_t cap = LEPT_OBJECT_HASH_MIN_SIZE;
+    if (size < LEPT_OBJECT_HASH_MIN_SIZE)
+        return 0;
+    while (cap < size * 2)
+        cap *= 2;
+    return cap;
+}
+
+static size_t lept_hash(const char* s, size_t len) {
+    size_t h = 2166136261u; /* FNV-1a */
+    while (len-- > 0)
+        h = (h ^ (unsigned char)*s++) * 16777619u;
+    return h;
+}
+
+/* Moves the top size members of the stack into object v, indexed if there are enough of them */
+static void lept_context_pop_object(lept_context* c, lept_value* v, size_t size) {
+    size_t s = size * sizeof(lept_member), cap = lept_hash_capacity(size), i, h, *t;
+    v->type = LEPT_OBJECT;
+    v->u.o.size = size;
+    v->u.o.m = NULL;
+    if (size == 0)
+        return;
+    memcpy(v->u.o.m = (lept_member*)lept_context_alloc(c, s + cap * sizeof(size_t)), lept_context_pop(c, s), s);
+    if (c->arena != NULL)
+        v->flags |= LEPT_ARENA;
+    if (cap == 0)
+        return;
+    memset(t = (size_t*)(v->u.o.m + size), 0, cap * sizeof(size_t));
+    for (i = 0; i < size; i++) {
+        for (h = lept_hash(v->u.o.m[i].k, v->u.o.m[i].klen) & (cap - 1); t[h] != 0; h = (h + 1) & (cap - 1))
+            ;
+        t[h] = i + 1;
+    }
+    v->flags |= LEPT_HASHED;
+}
+
+#define ISWHITESPACE(ch)    ((ch) == ' ' || (ch) == '\t' || (ch) == '\n' || (ch) == '\r')
+
+#if defined(LEPT_SSE2) || !defined(__GNUC__)
+/* Index of the lowest set bit, mask must be non-zero */
+static unsigned lept_ctz(unsigned mask) {
+#if defined(__GNUC__)
+    return (unsigned)__builtin_ctz(mask);
+#elif defined(_MSC_VER)
+    unsigned long i;
+    _BitScanForward(&i, mask);
+    return (unsigned)i;
+#else
+    unsigned i = 0;
+    while (!(mask & 1)) {
+        mask >>= 1;
+        i++;
+    }
+    return i;
+#endif
+}
+#endif
+
+static unsigned lept_ctz64(lept_uint64 mask) {
+#if defined(__GNUC__)
+    return (unsigned)__builtin_ctzll(mask);
+#else
+    return (mask & 0xFFFFFFFFu) != 0 ? lept_ctz((unsigned)(mask & 0xFFFFFFFFu)) : 32 + lept_ctz((unsigned)(mask >> 32));
+#endif
+}
+
+static unsigned lept_popcount64(lept_uint64 mask) {
+#if defined(__GNUC__)
+    return (unsigned)__builtin_popcountll(mask);
+#else
+    const lept_uint64 m1 = (lept_uint64)0x55555555u << 32 | 0x55555555u, m2 = (lept_uint64)0x33333333u << 32 | 0x33333333u;
+    const lept_uint64 m4 = (lept_uint64)0x0F0F0F0Fu << 32 | 0x0F0F0F0Fu, h01 = (lept_uint64)0x01010101u << 32 | 0x01010101u;
+    mask -= (mask >> 1) & m1;
+    mask = (mask & m2) + ((mask >> 2) & m2);
+    mask = (mask + (mask >> 4)) & m4;
+    return (unsigned)((mask * h01) >> 56);
+#endif
+}
+
+/*
+ * Stage 1 of a whole-document parse, the structural index: in input order, the offset of every structural character
+ * and of the first byte of every other token outside strings, and after each opening quote the offset of its closing
+ * quote, marked LEPT_INDEX_DIRTY if the string holds a backslash or a control character.
+ * Stage 2, the parser, takes the next token from the index instead of scanning whitespace, and the end of a clean
+ * string instead of scanning its body. It still reads every token it parses, so errors are the same as without index.
+ */
+#define LEPT_INDEX_DIRTY    0x80000000u
+#define LEPT_INDEX_MAX      0x7FFFFFFFu /* longer inputs are parsed without index */
+
+#ifndef LEPT_INDEX_CHUNK_SIZE
+#define LEPT_INDEX_CHUNK_SIZE 16384 /* bytes indexed ahead of stage 2 at a time, a multiple of 64 */
+#endif
+
+/* One bit per byte of a 64-byte block */
+typedef struct {
+    lept_uint64 quote, backslash, space, op, control;
+}lept_block;
+
+static void lept_block_classify(lept_block* b, const char* p) {
+    int i;
+#ifdef LEPT_SSE2
+    const __m128i quote = _mm_set1_epi8('\"'), backslash = _mm_set1_epi8('\\'), control = _mm_set1_epi8(0x1F);
+    const __m128i sp = _mm_set1_epi8(' '), tab = _mm_set1_epi8('\t'), lf = _mm_set1_epi8('\n'), cr = _mm_set1_epi8('\r');
+    const __m128i lower = _mm_set1_epi8(0x20), curly = _mm_set1_epi8('{'), close = _mm_set1_epi8('}');
+    const __m128i colon = _mm_set1_epi8(':'), comma = _mm_set1_epi8(',');
+    b->quote = b->backslash = b->space = b->op = b->control = 0;
+    for (i = 0; i < 64; i += 16) {
+        const __m128i s = _mm_loadu_si128((const __m128i*)(p + i)), l = _mm_or_si128(s, lower); /* '[' -> '{' */
+        __m128i x = _mm_or_si128(_mm_cmpeq_epi8(s, sp), _mm_cmpeq_epi8(s, tab));
+        x = _mm_or_si128(x, _mm_or_si128(_mm_cmpeq_epi8(s, lf), _mm_cmpeq_epi8(s, cr)));
+        b->space |= (lept_uint64)(unsigned)_mm_movemask_epi8(x) << i;
+        x = _mm_or_si128(_mm_cmpeq_epi8(l, curly), _mm_cmpeq_epi8(l, close));
+        x = _mm_or_si128(x, _mm_or_si128(_mm_cmpeq_epi8(s, colon), _mm_cmpeq_epi8(s, comma)));
+        b->op |= (lept_uint64)(unsigned)_mm_movemask_epi8(x) << i;
+        b->quote |= (lept_uint64)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(s, quote)) << i;
+        b->backslash |= (lept_uint64)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(s, backslash)) << i;
+        x = _mm_cmpeq_epi8(_mm_max_epu8(s, control), control); /* s <= 0x1F, unsigned */
+        b->control |= (lept_uint64)(unsigned)_mm_movemask_epi8(x) << i;
+    }
+#else
+    b->quote = b->backslash = b->space = b->op = b->control = 0;
+    for (i = 0; i < 64; i++) {
+        lept_uint64 bit = (lept_uint64)1 << i;
+        switch (p[i]) {
+            case '\"': b->quote |= bit; break;
+            case '\\': b->backslash |= bit; break;
+            case ' ':  b->space |= bit; break;
+            case '\t': case '\n': case '\r': b->space |= bit; b->control |= bit; break;
+            case '[': case ']': case '{': case '}': case ':': case ',': b->op |= bit; break;
+            default:
+                if ((unsigned char)p[i] < 0x20)
+                    b->control |= bit;
+        }
+    }
+#endif
+}
+
+typedef struct lept_index {
+    unsigned* pos; size_t n;    /* offsets into json of the entries indexed ahead of the parser */
+    size_t next;                /* first entry stage 2 has not passed */
+    const char* json; size_t len, done; /* input, bytes indexed so far */
+    lept_uint64 escaped, inside, sep;   /* carried from one block to the next */
+    int dirty;                          /* the open string holds a backslash or control character */
+    const lept_allocator* allocator;
+}lept_index;
+
+/* Stage 1 runs a chunk at a time just ahead of stage 2, so the entries stay in cache; false if json is too long */
+static int lept_index_init(lept_index* x, const char* json, size_t len, const lept_allocator* a) {
+    if (len > LEPT_INDEX_MAX)
+        return 0;
+    x->pos = (unsigned*)LEPT_MALLOC(a, (LEPT_INDEX_CHUNK_SIZE + 64) * sizeof(unsigned));
+    x->n = x->next = 0;
+    x->json = json;
+    x->len = len;
+    x->done = 0;
+    x->escaped = x->inside = 0;
+    x->sep = 1; /* the input starts as after a separator */
+    x->dirty = 0;
+    x->allocator = a;
+    return 1;
+}
+
+/* Keeps the entries not passed yet and appends those of the next chunk */
+static void lept_index_fill(lept_index* x) {
+    size_t i, end = x->len - x->done > LEPT_INDEX_CHUNK_SIZE ? x->done + LEPT_INDEX_CHUNK_SIZE : x->len;
+    char tail[64];
+    memmove(x->pos, x->pos + x->next, (x->n - x->next) * sizeof(unsigned));
+    x->n -= x->next;
+    x->next = 0;
+    for (i = x->done; i < end; i += 64) {
+        lept_block b;
+        lept_uint64 bs, escaped, q, inside, sep, starts, closes, stop, emit, done = 0;
+        if (end - i >= 64)
+            lept_block_classify(&b, x->json + i);
+        else { /* padded with whitespace, which adds no entries */
+            memset(tail, ' ', sizeof(tail));
+            memcpy(tail, x->json + i, end - i);
+            lept_block_classify(&b, tail);
+        }
+        /* every backslash that is not escaped itself escapes the next character */
+        escaped = x->escaped;
+        x->escaped = 0;
+        for (bs = b.backslash & ~escaped; bs != 0; bs &= ~(escaped | (bs & (~bs + 1)))) {
+            lept_uint64 bit = bs & (~bs + 1);
+            if ((bit << 1) == 0)
+                x->escaped = 1;
+            escaped |= bit << 1;
+        }
+        /* the other quotes delimit strings: inside runs from an opening quote up to its closing quote */
+        q = b.quote & ~escaped;
+        inside = q ^ (q << 1);
+        inside ^= inside << 2;
+        inside ^= inside << 4;
+        inside ^= inside << 8;
+        inside ^= inside << 16;
+        inside ^= inside << 32;
+        inside ^= x->inside;
+        x->inside = (inside >> 63) != 0 ? ~(lept_uint64)0 : 0;
+        sep = b.space | b.op;
+        starts = (b.op & ~inside) | (q & inside) | (~(sep | b.quote) & ~inside & ((sep << 1) | x->sep));
+        x->sep = sep >> 63;
+        closes = q & ~inside;
+        stop = (b.backslash | b.control) & inside;
+        emit = starts | closes;
+        if (stop == 0 && !x->dirty) { /* most blocks: every string in them is clean */
+            /* four entries at a time whatever the count, as a loop exit per entry would be mispredicted */
+            unsigned* out = x->pos + x->n, base = (unsigned)i, k, count = lept_popcount64(emit);
+            const lept_uint64 top = (lept_uint64)1 << 63; /* keeps the mask of the extra entries non-zero */
+            for (k = 0; k < count; k += 4, out += 4) {
+                out[0] = base + lept_ctz64(emit | top); emit &= emit - 1;
+                out[1] = base + lept_ctz64(emit | top); emit &= emit - 1;
+                out[2] = base + lept_ctz64(emit | top); emit &= emit - 1;
+                out[3] = base + lept_ctz64(emit | top); emit &= emit - 1;
+            }
+            x->n += count;
+            continue;
+        }
+        for (; emit != 0; emit &= emit - 1) {
+            lept_uint64 bit = emit & (~emit + 1);
+            unsigned off = (unsigned)(i + lept_ctz64(emit));
+            x->dirty |= (stop & ~done & (bit - 1)) != 0; /* only a closing quote can follow the bytes of a string */
+            x->pos[x->n++] = (closes & bit) && x->dirty ? off | LEPT_INDEX_DIRTY : off;
+            x->dirty = 0;
+            done = (bit << 1) - 1;
+        }
+        x->dirty |= (stop & ~done) != 0;
+    }
+    x->done = end;
+}
+
+/* Moves past the entries before p, indexing ahead until need entries are left or the input is exhausted */
+static int lept_index_seek(lept_index* x, const char* p, size_t need) {
+    unsigned off = (unsigned)(p - x->json);
+    size_t i = x->next;
+    for (;;) {
+        while (i < x->n && (x->pos[i] & ~LEPT_INDEX_DIRTY) < off)
+            i++;
+        x->next = i;
+        if (x->n - i >= need || x->done == x->len)
+            return x->n - i >= need;
+        lept_index_fill(x);
+        i = 0;
+    }
+}
+
+/* The closing quote of the string that opens at p if it is clean, otherwise NULL */
+static const char* lept_index_string(lept_index* x, const char* p) {
+    if (lept_index_seek(x, p, 2) && x->pos[x->next] == (unsigned)(p - x->json) && !(x->pos[x->next + 1] & LEPT_INDEX_DIRTY)) {
+        x->next += 2;
+        return x->json + x->pos[x->next - 1];
+    }
+    return NULL;
+}
+
+#ifdef LEPT_SSE2
+/* Skip whitespace 16 bytes at a time, never reading at or past end. Returns end if the input ends before. */
+static const char* lept_skip_whitespace_sse2(const char* p, const char* end) {
+    const __m128i sp = _mm_set1_epi8(' '), tab = _mm_set1_epi8('\t');
+    const __m128i lf = _mm_set1_epi8('\n'), cr = _mm_set1_epi8('\r');
+    for (; end - p >= 16; p += 16) {
+        const __m128i s = _mm_loadu_si128((const __m128i*)p);
+        __m128i x = _mm_cmpeq_epi8(s, sp);
+        unsigned mask;
+        x = _mm_or_si128(x, _mm_cmpeq_epi8(s, tab));
+        x = _mm_or_si128(x, _mm_cmpeq_epi8(s, lf));
+        x = _mm_or_si128(x, _mm_cmpeq_epi8(s, cr));
+        mask = ~(unsigned)_mm_movemask_epi8(x) & 0xFFFF;
+        if (mask != 0)
+            return p + lept_ctz(mask);
+    }
+    while (p != end && ISWHITESPACE(*p))
+        p++;
+    return p;
+}
+#endif
+
 static void lept_parse_whitespace(lept_context* c) {
-    const char *p = c->json;
-    while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')
+    const char *p = c->json, *end = c->end;
+    lept_index* x = c->index;
+    if (p == end || !ISWHITESPACE(*p))
+        return;
+    /* Most runs are empty or a single separator, so only go wide or to the index after two whitespace characters */
+    if (++p == end || !ISWHITESPACE(*p)) {
+        c->json = p;
+        return;
+    }
+    if (x != NULL) { /* whitespace outside strings always ends at an entry */
+        c->json = lept_index_seek(x, p, 1) ? x->json + (x->pos[x->next] & ~LEPT_INDEX_DIRTY) : end;
+        return;
+    }
+#ifdef LEPT_SSE2
+    p = lept_skip_whitespace_sse2(p + 1, end);
+#else
+    while (p != end && ISWHITESPACE(*p))
         p++;
+#endif
     c->json = p;
 }
 
-static int lept_parse_literal(lept_context* c, lept_value* v, const char* literal, lept_type type) {
-    size_t i;
-    EXPECT(c, literal[0]);
-    for (i = 0; literal[i + 1]; i++)
-        if (c->json[i] != literal[i + 1])
-            return LEPT_PARSE_INVALID_VALUE;
-    c->json += i;
+static int lept_parse_literal(lept_context* c, lept_value* v, const char* literal, size_t len, lept_type type) {
+    if ((size_t)(c->end - c->json) < len || memcmp(c->json, literal, len) != 0)
+        return LEPT_PARSE_INVALID_VALUE;
+    c->json += len;
     v->type = type;
     return LEPT_PARSE_OK;
 }
 
+/*
+ * Arbitrary precision decimal 0.d[0]d[1]...d[nd-1] * 10^dp, for numbers that double arithmetic cannot convert exactly.
+ * Converting by binary shifts of the decimal digits is slow but correctly rounded (see Go's strconv/decimal.go).
+ */
+typedef struct {
+    unsigned char d[LEPT_DECIMAL_MAX_DIGITS]; /* digit values, no leading zero */
+    int nd, dp;
+    int trunc;                                /* non-zero digits were dropped beyond d[] */
+}lept_decimal;
+
+#define LEPT_DECIMAL_MAX_SHIFT 28 /* 9 << 28 and the carries still fit in 32 bits */
+
+static void lept_decimal_trim(lept_decimal* a) {
+    while (a->nd > 0 && a->d[a->nd - 1] == 0)
+        a->nd--;
+    if (a->nd == 0)
+        a->dp = 0;
+}
+
+static void lept_decimal_left_shift(lept_decimal* a, unsigned k) {
+    unsigned char buf[LEPT_DECIMAL_MAX_DIGITS + 10];
+    int r, w = (int)sizeof(buf), n;
+    unsigned long acc = 0;
+    for (r = a->nd - 1; r >= 0; r--) {
+        acc += (unsigned long)a->d[r] << k;
+        buf[--w] = (unsigned char)(acc % 10);
+        acc /= 10;
+    }
+    for (; acc > 0; acc /= 10)
+        buf[--w] = (unsigned char)(acc % 10);
+    n = (int)sizeof(buf) - w;
+    a->dp += n - a->nd;
+    if (n > LEPT_DECIMAL_MAX_DIGITS) {
+        for (r = w + LEPT_DECIMAL_MAX_DIGITS; r < (int)sizeof(buf); r++)
+            if (buf[r] != 0)
+                a->trunc = 1;
+        n = LEPT_DECIMAL_MAX_DIGITS;
+    }
+    memcpy(a->d, buf + w, n);
+    a->nd = n;
+    lept_decimal_trim(a);
+}
+
+static void lept_decimal_right_shift(lept_decimal* a, unsigned k) {
+    int r = 0, w = 0;
+    unsigned long n = 0, mask = (1UL << k) - 1;
+    /* Pick up enough leading digits to cover the first shift */
+    for (; (n >> k) == 0; r++) {
+        if (r >= a->nd) {
+            if (n == 0) {
+                a->nd = a->dp = 0;
+                return;
+            }
+            while ((n >> k) == 0) {
+                n *= 10;
+                r++;
+            }
+            break;
+        }
+        n = n * 10 + a->d[r];
+    }
+    a->dp -= r - 1;
+    /* Pick up a digit, put down a digit */
+    for (; r < a->nd; r++) {
+        unsigned long ch = a->d[r];
+        a->d[w++] = (unsigned char)(n >> k);
+        n = (n & mask) * 10 + ch;
+    }
+    /* Put down the remaining digits */
+    for (; n > 0; n = (n & mask) * 10) {
+        if (w < LEPT_DECIMAL_MAX_DIGITS)
+            a->d[w++] = (unsigned char)(n >> k);
+        else if ((n >> k) > 0)
+            a->trunc = 1;
+    }
+    a->nd = w;
+    lept_decimal_trim(a);
+}
+
+static void lept_decimal_shift(lept_decimal* a, int k) {
+    if (a->nd == 0)
+        return;
+    for (; k > LEPT_DECIMAL_MAX_SHIFT; k -= LEPT_DECIMAL_MAX_SHIFT)
+        lept_decimal_left_shift(a, LEPT_DECIMAL_MAX_SHIFT);
+    for (; k < -LEPT_DECIMAL_MAX_SHIFT; k += LEPT_DECIMAL_MAX_SHIFT)
+        lept_decimal_right_shift(a, LEPT_DECIMAL_MAX_SHIFT);
+    if (k > 0)
+        lept_decimal_left_shift(a, k);
+    else if (k < 0)
+        lept_decimal_right_shift(a, -k);
+}
+
+/* Integer part rounded half to even, exact in double as the caller keeps it below 2^54 */
+static double lept_decimal_rounded_integer(const lept_decimal* a) {
+    double n = 0.0;
+    int i, up;
+    for (i = 0; i < a->dp && i < a->nd; i++)
+        n = n * 10 + a->d[i];
+    for (; i < a->dp; i++)
+        n *= 10;
+    if (a->dp < 0 || a->dp >= a->nd)
+        up = 0;
+    else if (a->d[a->dp] == 5 && a->dp + 1 == a->nd) /* exactly halfway, unless digits were dropped */
+        up = a->trunc || (a->dp > 0 && (a->d[a->dp - 1] & 1));
+    else
+        up = a->d[a->dp] >= 5;
+    return up ? n + 1 : n;
+}
+
+static int lept_decimal_to_double(lept_decimal* a, double* d) {
+    static const int powtab[] = { 1, 3, 6, 9, 13, 16, 19, 23, 26 }; /* 2^powtab[i] < 10^i */
+    int exp = 0, n;
+    double mant;
+    if (a->nd == 0 || a->dp < -330) {
+        *d = 0.0;
+        return LEPT_PARSE_OK;
+    }
+    if (a->dp > 310)
+        return LEPT_PARSE_NUMBER_TOO_BIG;
+    /* Scale by powers of two into [0.5, 1) */
+    while (a->dp > 0) {
+        n = a->dp >= 9 ? 27 : powtab[a->dp];
+        lept_decimal_shift(a, -n);
+        exp += n;
+    }
+    while (a->dp < 0 || (a->dp == 0 && a->d[0] < 5)) {
+        n = -a->dp >= 9 ? 27 : powtab[-a->dp];
+        lept_decimal_shift(a, n);
+        exp -= n;
+    }
+    exp--; /* [1, 2) as in IEEE-754 */
+    if (exp < -1022) { /* subnormal */
+        lept_decimal_shift(a, exp + 1022);
+        exp = -1022;
+    }
+    if (exp > 1023)
+        return LEPT_PARSE_NUMBER_TOO_BIG;
+    lept_decimal_shift(a, 53);
+    mant = lept_decimal_rounded_integer(a);
+    if (mant == 9007199254740992.0) { /* rounded up to 2^53 */
+        mant /= 2;
+        if (++exp > 1023)
+            return LEPT_PARSE_NUMBER_TOO_BIG;
+    }
+    *d = ldexp(mant, exp - 52);
+    return LEPT_PARSE_OK;
+}
+
+/*
+ * Eisel-Lemire: a mantissa of up to 19 digits times the first 128 bits of 5^e10 is nearly always enough to round
+ * correctly, and the cases where the truncated bits could matter are detected (see Go's strconv/eisel_lemire.go).
+ * The table covers the exponents of nearly all numbers in practice, the others take the slow path.
+ */
+#define LEPT_POW5_MIN (-64)
+#define LEPT_POW5_MAX 64
+#define LEPT_U64(hi, lo) ((lept_uint64)(hi) << 32 | (lept_uint64)(lo))
+
+static const lept_uint64 lept_pow5[LEPT_POW5_MAX - LEPT_POW5_MIN + 1][2] = { /* high and low 64 bits, truncated */
+    { LEPT_U64(0xA87FEA27u, 0xA539E9A5u), LEPT_U64(0x3F2398D7u, 0x47B36224u) }, /* 5^-64 */
+    { LEPT_U64(0xD29FE4B1u, 0x8E88640Eu), LEPT_U64(0x8EEC7F0Du, 0x19A03AADu) }, /* 5^-63 */
+    { LEPT_U64(0x83A3EEEEu, 0xF9153E89u), LEPT_U64(0x1953CF68u, 0x300424ACu) }, /* 5^-62 */
+    { LEPT_U64(0xA48CEAAAu, 0xB75A8E2Bu), LEPT_U64(0x5FA8C342u, 0x3C052DD7u) }, /* 5^-61 */
+    { LEPT_U64(0xCDB02555u, 0x653131B6u), LEPT_U64(0x3792F412u, 0xCB06794Du) }, /* 5^-60 */
+    { LEPT_U64(0x808E1755u, 0x5F3EBF11u), LEPT_U64(0xE2BBD88Bu, 0xBEE40BD0u) }, /* 5^-59 */
+    { LEPT_U64(0xA0B19D2Au, 0xB70E6ED6u), LEPT_U64(0x5B6ACEAEu, 0xAE9D0EC4u) }, /* 5^-58 */
+    { LEPT_U64(0xC8DE0475u, 0x64D20A8Bu), LEPT_U64(0xF245825Au, 0x5A445275u) }, /* 5^-57 */
+    { LEPT_U64(0xFB158592u, 0xBE068D2Eu), LEPT_U64(0xEED6E2F0u, 0xF0D56712u) }, /* 5^-56 */
+    { LEPT_U64(0x9CED737Bu, 0xB6C4183Du), LEPT_U64(0x55464DD6u, 0x9685606Bu) }, /* 5^-55 */
+    { LEPT_U64(0xC428D05Au, 0xA4751E4Cu), LEPT_U64(0xAA97E14Cu, 0x3C26B886u) }, /* 5^-54 */
+    { LEPT_U64(0xF5330471u, 0x4D9265DFu), LEPT_U64(0xD53DD99Fu, 0x4B3066A8u) }, /* 5^-53 */
+    { LEPT_U64(0x993FE2C6u, 0xD07B7FABu), LEPT_U64(0xE546A803u, 0x8EFE4029u) }, /* 5^-52 */
+    { LEPT_U64(0xBF8FDB78u, 0x849A5F96u), LEPT_U64(0xDE985204u, 0x72BDD033u) }, /* 5^-51 */
+    { LEPT_U64(0xEF73D256u, 0xA5C0F77Cu), LEPT_U64(0x963E6685u, 0x8F6D4440u) }, /* 5^-50 */
+    { LEPT_U64(0x95A86376u, 0x27989AADu), LEPT_U64(0xDDE70013u, 0x79A44AA8u) }, /* 5^-49 */
+    { LEPT_U64(0xBB127C53u, 0xB17EC159u), LEPT_U64(0x5560C018u, 0x580D5D52u) }, /* 5^-48 */
+    { LEPT_U64(0xE9D71B68u, 0x9DDE71AFu), LEPT_U64(0xAAB8F01Eu, 0x6E10B4A6u) }, /* 5^-47 */
+    { LEPT_U64(0x92267121u, 0x62AB070Du), LEPT_U64(0xCAB39613u, 0x04CA70E8u) }, /* 5^-46 */
+    { LEPT_U64(0xB6B00D69u, 0xBB55C8D1u), LEPT_U64(0x3D607B97u, 0xC5FD0D22u) }, /* 5^-45 */
+    { LEPT_U64(0xE45C10C4u, 0x2A2B3B05u), LEPT_U64(0x8CB89A7Du, 0xB77C506Au) }, /* 5^-44 */
+    { LEPT_U64(0x8EB98A7Au, 0x9A5B04E3u), LEPT_U64(0x77F3608Eu, 0x92ADB242u) }, /* 5^-43 */
+    { LEPT_U64(0xB267ED19u, 0x40F1C61Cu), LEPT_U64(0x55F038B2u, 0x37591ED3u) }, /* 5^-42 */
+    { LEPT_U64(0xDF01E85Fu, 0x912E37A3u), LEPT_U64(0x6B6C46DEu, 0xC52F6688u) }, /* 5^-41 */
+    { LEPT_U64(0x8B61313Bu, 0xBABCE2C6u), LEPT_U64(0x2323AC4Bu, 0x3B3DA015u) }, /* 5^-40 */
+    { LEPT_U64(0xAE397D8Au, 0xA96C1B77u), LEPT_U64(0xABEC975Eu, 0x0A0D081Au) }, /* 5^-39 */
+    { LEPT_U64(0xD9C7DCEDu, 0x53C72255u), LEPT_U64(0x96E7BD35u, 0x8C904A21u) }, /* 5^-38 */
+    { LEPT_U64(0x881CEA14u, 0x545C7575u), LEPT_U64(0x7E50D641u, 0x77DA2E54u) }, /* 5^-37 */
+    { LEPT_U64(0xAA242499u, 0x697392D2u), LEPT_U64(0xDDE50BD1u, 0xD5D0B9E9u) }, /* 5^-36 */
+    { LEPT_U64(0xD4AD2DBFu, 0xC3D07787u), LEPT_U64(0x955E4EC6u, 0x4B44E864u) }, /* 5^-35 */
+    { LEPT_U64(0x84EC3C97u, 0xDA624AB4u), LEPT_U64(0xBD5AF13Bu, 0xEF0B113Eu) }, /* 5^-34 */
+    { LEPT_U64(0xA6274BBDu, 0xD0FADD61u), LEPT_U64(0xECB1AD8Au, 0xEACDD58Eu) }, /* 5^-33 */
+    { LEPT_U64(0xCFB11EADu, 0x453994BAu), LEPT_U64(0x67DE18EDu, 0xA5814AF2u) }, /* 5^-32 */
+    { LEPT_U64(0x81CEB32Cu, 0x4B43FCF4u), LEPT_U64(0x80EACF94u, 0x8770CED7u) }, /* 5^-31 */
+    { LEPT_U64(0xA2425FF7u, 0x5E14FC31u), LEPT_U64(0xA1258379u, 0xA94D028Du) }, /* 5^-30 */
+    { LEPT_U64(0xCAD2F7F5u, 0x359A3B3Eu), LEPT_U64(0x096EE458u, 0x13A04330u) }, /* 5^-29 */
+    { LEPT_U64(0xFD87B5F2u, 0x8300CA0Du), LEPT_U64(0x8BCA9D6Eu, 0x188853FCu) }, /* 5^-28 */
+    { LEPT_U64(0x9E74D1B7u, 0x91E07E48u), LEPT_U64(0x775EA264u, 0xCF55347Du) }, /* 5^-27 */
+    { LEPT_U64(0xC6120625u, 0x76589DDAu), LEPT_U64(0x95364AFEu, 0x032A819Du) }, /* 5^-26 */
+    { LEPT_U64(0xF79687AEu, 0xD3EEC551u), LEPT_U64(0x3A83DDBDu, 0x83F52204u) }, /* 5^-25 */
+    { LEPT_U64(0x9ABE14CDu, 0x44753B52u), LEPT_U64(0xC4926A96u, 0x72793542u) }, /* 5^-24 */
+    { LEPT_U64(0xC16D9A00u, 0x95928A27u), LEPT_U64(0x75B7053Cu, 0x0F178293u) }, /* 5^-23 */
+    { LEPT_U64(0xF1C90080u, 0xBAF72CB1u), LEPT_U64(0x5324C68Bu, 0x12DD6338u) }, /* 5^-22 */
+    { LEPT_U64(0x971DA050u, 0x74DA7BEEu), LEPT_U64(0xD3F6FC16u, 0xEBCA5E03u) }, /* 5^-21 */
+    { LEPT_U64(0xBCE50864u, 0x92111AEAu), LEPT_U64(0x88F4BB1Cu, 0xA6BCF584u) }, /* 5^-20 */
+    { LEPT_U64(0xEC1E4A7Du, 0xB69561A5u), LEPT_U64(0x2B31E9E3u, 0xD06C32E5u) }, /* 5^-19 */
+    { LEPT_U64(0x9392EE8Eu, 0x921D5D07u), LEPT_U64(0x3AFF322Eu, 0x62439FCFu) }, /* 5^-18 */
+    { LEPT_U64(0xB877AA32u, 0x36A4B449u), LEPT_U64(0x09BEFEB9u, 0xFAD487C2u) }, /* 5^-17 */
+    { LEPT_U64(0xE69594BEu, 0xC44DE15Bu), LEPT_U64(0x4C2EBE68u, 0x7989A9B3u) }, /* 5^-16 */
+    { LEPT_U64(0x901D7CF7u, 0x3AB0ACD9u), LEPT_U64(0x0F9D3701u, 0x4BF60A10u) }, /* 5^-15 */
+    { LEPT_U64(0xB424DC35u, 0x095CD80Fu), LEPT_U64(0x538484C1u, 0x9EF38C94u) }, /* 5^-14 */
+    { LEPT_U64(0xE12E1342u, 0x4BB40E13u), LEPT_U64(0x2865A5F2u, 0x06B06FB9u) }, /* 5^-13 */
+    { LEPT_U64(0x8CBCCC09u, 0x6F5088CBu), LEPT_U64(0xF93F87B7u, 0x442E45D3u) }, /* 5^-12 */
+    { LEPT_U64(0xAFEBFF0Bu, 0xCB24AAFEu), LEPT_U64(0xF78F69A5u, 0x1539D748u) }, /* 5^-11 */
+    { LEPT_U64(0xDBE6FECEu, 0xBDEDD5BEu), LEPT_U64(0xB573440Eu, 0x5A884D1Bu) }, /* 5^-10 */
+    { LEPT_U64(0x89705F41u, 0x36B4A597u), LEPT_U64(0x31680A88u, 0xF8953030u) }, /* 5^-9 */
+    { LEPT_U64(0xABCC7711u, 0x8461CEFCu), LEPT_U64(0xFDC20D2Bu, 0x36BA7C3Du) }, /* 5^-8 */
+    { LEPT_U64(0xD6BF94D5u, 0xE57A42BCu), LEPT_U64(0x3D329076u, 0x04691B4Cu) }, /* 5^-7 */
+    { LEPT_U64(0x8637BD05u, 0xAF6C69B5u), LEPT_U64(0xA63F9A49u, 0xC2C1B10Fu) }, /* 5^-6 */
+    { LEPT_U64(0xA7C5AC47u, 0x1B478423u), LEPT_U64(0x0FCF80DCu, 0x33721D53u) }, /* 5^-5 */
+    { LEPT_U64(0xD1B71758u, 0xE219652Bu), LEPT_U64(0xD3C36113u, 0x404EA4A8u) }, /* 5^-4 */
+    { LEPT_U64(0x83126E97u, 0x8D4FDF3Bu), LEPT_U64(0x645A1CACu, 0x083126E9u) }, /* 5^-3 */
+    { LEPT_U64(0xA3D70A3Du, 0x70A3D70Au), LEPT_U64(0x3D70A3D7u, 0x0A3D70A3u) }, /* 5^-2 */
+    { LEPT_U64(0xCCCCCCCCu, 0xCCCCCCCCu), LEPT_U64(0xCCCCCCCCu, 0xCCCCCCCCu) }, /* 5^-1 */
+    { LEPT_U64(0x80000000u, 0x00000000u), LEPT_U64(0x00000000u, 0x00000000u) }, /* 5^0 */
+    { LEPT_U64(0xA0000000u, 0x00000000u), LEPT_U64(0x00000000u, 0x00000000u) }, /* 5^1 */
+    { LEPT_U64(0xC8000000u, 0x00000000u), LEPT_U64(0x00000000u, 0x00000000u) }, /* 5^2 */
+    { LEPT_U64(0xFA000000u, 0x00000000u), LEPT_U64(0x00000000u, 0x00000000u) }, /* 5^3 */
+    { LEPT_U64(0x9C400000u, 0x00000000u), LEPT_U64(0x00000000u, 0x00000000u) }, /* 5^4 */
+    { LEPT_U64(0xC3500000u, 0x00000000u), LEPT_U64(0x00000000u, 0x00000000u) }, /* 5^5 */
+    { LEPT_U64(0xF4240000u, 0x00000000u), LEPT_U64(0x00000000u, 0x00000000u) }, /* 5^6 */
+    { LEPT_U64(0x98968000u, 0x00000000u), LEPT_U64(0x00000000u, 0x00000000u) }, /* 5^7 */
+    { LEPT_U64(0xBEBC2000u, 0x00000000u), LEPT_U64(0x00000000u, 0x00000000u) }, /* 5^8 */
+    { LEPT_U64(0xEE6B2800u, 0x00000000u), LEPT_U64(0x00000000u, 0x00000000u) }, /* 5^9 */
+    { LEPT_U64(0x9502F900u, 0x00000000u), LEPT_U64(0x00000000u, 0x00000000u) }, /* 5^10 */
+    { LEPT_U64(0xBA43B740u, 0x00000000u), LEPT_U64(0x00000000u, 0x00000000u) }, /* 5^11 */
+    { LEPT_U64(0xE8D4A510u, 0x00000000u), LEPT_U64(0x00000000u, 0x00000000u) }, /* 5^12 */
+    { LEPT_U64(0x9184E72Au, 0x00000000u), LEPT_U64(0x00000000u, 0x00000000u) }, /* 5^13 */
+    { LEPT_U64(0xB5E620F4u, 0x80000000u), LEPT_U64(0x00000000u, 0x00000000u) }, /* 5^14 */
+    { LEPT_U64(0xE35FA931u, 0xA0000000u), LEPT_U64(0x00000000u, 0x00000000u) }, /* 5^15 */
+    { LEPT_U64(0x8E1BC9BFu, 0x04000000u), LEPT_U64(0x00000000u, 0x00000000u) }, /* 5^16 */
+    { LEPT_U64(0xB1A2BC2Eu, 0xC5000000u), LEPT_U64(0x00000000u, 0x00000000u) }, /* 5^17 */
+    { LEPT_U64(0xDE0B6B3Au, 0x76400000u), LEPT_U64(0x00000000u, 0x00000000u) }, /* 5^18 */
+    { LEPT_U64(0x8AC72304u, 0x89E80000u), LEPT_U64(0x00000000u, 0x00000000u) }, /* 5^19 */
+    { LEPT_U64(0xAD78EBC5u, 0xAC620000u), LEPT_U64(0x00000000u, 0x00000000u) }, /* 5^20 */
+    { LEPT_U64(0xD8D726B7u, 0x177A8000u), LEPT_U64(0x00000000u, 0x00000000u) }, /* 5^21 */
+    { LEPT_U64(0x87867832u, 0x6EAC9000u), LEPT_U64(0x00000000u, 0x00000000u) }, /* 5^22 */
+    { LEPT_U64(0xA968163Fu, 0x0A57B400u), LEPT_U64(0x00000000u, 0x00000000u) }, /* 5^23 */
+    { LEPT_U64(0xD3C21BCEu, 0xCCEDA100u), LEPT_U64(0x00000000u, 0x00000000u) }, /* 5^24 */
+    { LEPT_U64(0x84595161u, 0x401484A0u), LEPT_U64(0x00000000u, 0x00000000u) }, /* 5^25 */
+    { LEPT_U64(0xA56FA5B9u, 0x9019A5C8u), LEPT_U64(0x00000000u, 0x00000000u) }, /* 5^26 */
+    { LEPT_U64(0xCECB8F27u, 0xF4200F3Au), LEPT_U64(0x00000000u, 0x00000000u) }, /* 5^27 */
+    { LEPT_U64(0x813F3978u, 0xF8940984u), LEPT_U64(0x40000000u, 0x00000000u) }, /* 5^28 */
+    { LEPT_U64(0xA18F07D7u, 0x36B90BE5u), LEPT_U64(0x50000000u, 0x00000000u) }, /* 5^29 */
+    { LEPT_U64(0xC9F2C9CDu, 0x04674EDEu), LEPT_U64(0xA4000000u, 0x00000000u) }, /* 5^30 */
+    { LEPT_U64(0xFC6F7C40u, 0x45812296u), LEPT_U64(0x4D000000u, 0x00000000u) }, /* 5^31 */
+    { LEPT_U64(0x9DC5ADA8u, 0x2B70B59Du), LEPT_U64(0xF0200000u, 0x00000000u) }, /* 5^32 */
+    { LEPT_U64(0xC5371912u, 0x364CE305u), LEPT_U64(0x6C280000u, 0x00000000u) }, /* 5^33 */
+    { LEPT_U64(0xF684DF56u, 0xC3E01BC6u), LEPT_U64(0xC7320000u, 0x00000000u) }, /* 5^34 */
+    { LEPT_U64(0x9A130B96u, 0x3A6C115Cu), LEPT_U64(0x3C7F4000u, 0x00000000u) }, /* 5^35 */
+    { LEPT_U64(0xC097CE7Bu, 0xC90715B3u), LEPT_U64(0x4B9F1000u, 0x00000000u) }, /* 5^36 */
+    { LEPT_U64(0xF0BDC21Au, 0xBB48DB20u), LEPT_U64(0x1E86D400u, 0x00000000u) }, /* 5^37 */
+    { LEPT_U64(0x96769950u, 0xB50D88F4u), LEPT_U64(0x13144480u, 0x00000000u) }, /* 5^38 */
+    { LEPT_U64(0xBC143FA4u, 0xE250EB31u), LEPT_U64(0x17D955A0u, 0x00000000u) }, /* 5^39 */
+    { LEPT_U64(0xEB194F8Eu, 0x1AE525FDu), LEPT_U64(0x5DCFAB08u, 0x00000000u) }, /* 5^40 */
+    { LEPT_U64(0x92EFD1B8u, 0xD0CF37BEu), LEPT_U64(0x5AA1CAE5u, 0x00000000u) }, /* 5^41 */
+    { LEPT_U64(0xB7ABC627u, 0x050305ADu), LEPT_U64(0xF14A3D9Eu, 0x40000000u) }, /* 5^42 */
+    { LEPT_U64(0xE596B7B0u, 0xC643C719u), LEPT_U64(0x6D9CCD05u, 0xD0000000u) }, /* 5^43 */
+    { LEPT_U64(0x8F7E32CEu, 0x7BEA5C6Fu), LEPT_U64(0xE4820023u, 0xA2000000u) }, /* 5^44 */
+    { LEPT_U64(0xB35DBF82u, 0x1AE4F38Bu), LEPT_U64(0xDDA2802Cu, 0x8A800000u) }, /* 5^45 */
+    { LEPT_U64(0xE0352F62u, 0xA19E306Eu), LEPT_U64(0xD50B2037u, 0xAD200000u) }, /* 5^46 */
+    { LEPT_U64(0x8C213D9Du, 0xA502DE45u), LEPT_U64(0x4526F422u, 0xCC340000u) }, /* 5^47 */
+    { LEPT_U64(0xAF298D05u, 0x0E4395D6u), LEPT_U64(0x9670B12Bu, 0x7F410000u) }, /* 5^48 */
+    { LEPT_U64(0xDAF3F046u, 0x51D47B4Cu), LEPT_U64(0x3C0CDD76u, 0x5F114000u) }, /* 5^49 */
+    { LEPT_U64(0x88D8762Bu, 0xF324CD0Fu), LEPT_U64(0xA5880A69u, 0xFB6AC800u) }, /* 5^50 */
+    { LEPT_U64(0xAB0E93B6u, 0xEFEE0053u), LEPT_U64(0x8EEA0D04u, 0x7A457A00u) }, /* 5^51 */
+    { LEPT_U64(0xD5D238A4u, 0xABE98068u), LEPT_U64(0x72A49045u, 0x98D6D880u) }, /* 5^52 */
+    { LEPT_U64(0x85A36366u, 0xEB71F041u), LEPT_U64(0x47A6DA2Bu, 0x7F864750u) }, /* 5^53 */
+    { LEPT_U64(0xA70C3C40u, 0xA64E6C51u), LEPT_U64(0x999090B6u, 0x5F67D924u) }, /* 5^54 */
+    { LEPT_U64(0xD0CF4B50u, 0xCFE20765u), LEPT_U64(0xFFF4B4E3u, 0xF741CF6Du) }, /* 5^55 */
+    { LEPT_U64(0x82818F12u, 0x81ED449Fu), LEPT_U64(0xBFF8F10Eu, 0x7A8921A4u) }, /* 5^56 */
+    { LEPT_U64(0xA321F2D7u, 0x226895C7u), LEPT_U64(0xAFF72D52u, 0x192B6A0Du) }, /* 5^57 */
+    { LEPT_U64(0xCBEA6F8Cu, 0xEB02BB39u), LEPT_U64(0x9BF4F8A6u, 0x9F764490u) }, /* 5^58 */
+    { LEPT_U64(0xFEE50B70u, 0x25C36A08u), LEPT_U64(0x02F236D0u, 0x4753D5B4u) }, /* 5^59 */
+    { LEPT_U64(0x9F4F2726u, 0x179A2245u), LEPT_U64(0x01D76242u, 0x2C946590u) }, /* 5^60 */
+    { LEPT_U64(0xC722F0EFu, 0x9D80AAD6u), LEPT_U64(0x424D3AD2u, 0xB7B97EF5u) }, /* 5^61 */
+    { LEPT_U64(0xF8EBAD2Bu, 0x84E0D58Bu), LEPT_U64(0xD2E08987u, 0x65A7DEB2u) }, /* 5^62 */
+    { LEPT_U64(0x9B934C3Bu, 0x330C8577u), LEPT_U64(0x63CC55F4u, 0x9F88EB2Fu) }, /* 5^63 */
+    { LEPT_U64(0xC2781F49u, 0xFFCFA6D5u), LEPT_U64(0x3CBF6B71u, 0xC76B25FBu) }  /* 5^64 */
+};
+
+/* 128-bit product from four 32-bit partial products, returns the high 64 bits */
+static lept_uint64 lept_mul128(lept_uint64 a, lept_uint64 b, lept_uint64* lo) {
+    lept_uint64 a0 = a & 0xFFFFFFFFu, a1 = a >> 32, b0 = b & 0xFFFFFFFFu, b1 = b >> 32;
+    lept_uint64 p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0;
+    lept_uint64 mid = (p00 >> 32) + (p01 & 0xFFFFFFFFu) + (p10 & 0xFFFFFFFFu);
+    *lo = mid << 32 | (p00 & 0xFFFFFFFFu);
+    return a1 * b1 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+}
+
+/* w * 10^e10 for 0 < w, false if the product is too close to halfway or out of the range of the table */
+static int lept_eisel_lemire(lept_uint64 w, int e10, double* d) {
+    const lept_uint64* pow5;
+    lept_uint64 hi, lo, mant;
+    long exp2;
+    int clz = 0;
+    if (e10 < LEPT_POW5_MIN || e10 > LEPT_POW5_MAX)
+        return 0;
+    pow5 = lept_pow5[e10 - LEPT_POW5_MIN];
+    while (!(w >> 63)) {
+        w <<= 1;
+        clz++;
+    }
+    /* floor(log2(10^e10)) + 64 - clz as a biased exponent, 217706 / 2^16 being log2(10) */
+    exp2 = (e10 >= 0 ? 217706L * e10 >> 16 : -((-217706L * e10 + 65535) >> 16)) + 64 + 1023 - clz;
+    hi = lept_mul128(w, pow5[0], &lo);
+    if ((hi & 0x1FF) == 0x1FF && lo + w < w) { /* the low bits of 5^e10 could carry into the result */
+        lept_uint64 lo2, hi2 = lept_mul128(w, pow5[1], &lo2);
+        if (lo + hi2 < lo)
+            hi++;
+        lo += hi2;
+        if ((hi & 0x1FF) == 0x1FF && lo + 1 == 0 && lo2 + w < w)
+            return 0;
+    }
+    mant = hi >> (hi >> 63) >> 9; /* 54 bits */
+    exp2 -= 1 ^ (long)(hi >> 63);
+    if (lo == 0 && (hi & 0x1FF) == 0 && (mant & 3) == 1) /* halfway, but maybe not exactly */
+        return 0;
+    mant = (mant + (mant & 1)) >> 1;
+    if (mant >> 53) {
+        mant >>= 1;
+        exp2++;
+    }
+    if (exp2 < 1 || exp2 > 0x7FE) /* subnormal or too big */
+        return 0;
+    *d = ldexp((double)mant, (int)exp2 - 1023 - 52);
+    return 1;
+}
+
+/* Converts the digits validated by lept_parse_number(): integer part [i, ie), fraction [f, fe), exponent exp */
+static int lept_strtod(const char* i, const char* ie, const char* f, const char* fe, int exp, double* d) {
+    static const double pow10[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    lept_decimal a;
+    const char* p;
+    lept_uint64 w = 0;
+    int nd = 0, e10 = exp - (int)(fe - f);
+    for (p = i; p != fe && nd <= 19; p = (p + 1 == ie ? f : p + 1))
+        if (nd > 0 || *p != '0') {
+            w = w * 10 + (unsigned)(*p - '0');
+            nd++;
+        }
+    if (nd == 0) {
+        *d = 0.0;
+        return LEPT_PARSE_OK;
+    }
+    /* Fast path: up to 2^53 and 10^22 are exact in double, so the result is rounded once (Clinger) */
+    if (nd <= 19 && w <= LEPT_U64(0x200000u, 0) && e10 >= -22 && e10 <= 22) {
+        *d = e10 < 0 ? (double)w / pow10[-e10] : (double)w * pow10[e10];
+        return LEPT_PARSE_OK;
+    }
+    if (nd <= 19 && lept_eisel_lemire(w, e10, d))
+        return LEPT_PARSE_OK;
+    /* Slow path */
+    a.nd = a.dp = a.trunc = 0;
+    for (p = i; p != ie; p++) {
+        if (a.nd == 0 && *p == '0')
+            continue;
+        a.dp++;
+        if (a.nd < LEPT_DECIMAL_MAX_DIGITS)
+            a.d[a.nd++] = (unsigned char)(*p - '0');
+        else if (*p != '0')
+            a.trunc = 1;
+    }
+    for (p = f; p != fe; p++) {
+        if (a.nd == 0 && *p == '0')
+            a.dp--;
+        else if (a.nd < LEPT_DECIMAL_MAX_DIGITS)
+            a.d[a.nd++] = (unsigned char)(*p - '0');
+        else if (*p != '0')
+            a.trunc = 1;
+    }
+    a.dp += exp;
+    lept_decimal_trim(&a);
+    return lept_decimal_to_double(&a, d);
+}
+
+/* Integers that fit are kept exact, except -0 which only a double can represent */
+static int lept_parse_int64(const char* i, const char* ie, int minus, lept_value* v) {
+    static const char max[] = "9223372036854775807", min[] = "9223372036854775808";
+    lept_int64 n = 0;
+    if (ie - i > 19 || (ie - i == 19 && memcmp(i, minus ? min : max, 19) > 0) || (minus && *i == '0'))
+        return 0;
+    for (; i != ie; i++)
+        n = n * 10 - (*i - '0'); /* negative, so that the minimum fits */
+    v->u.i = minus ? n : -n;
+    v->type = LEPT_NUMBER;
+    v->flags |= LEPT_INT64;
+    return 1;
+}
+
+#define ISDIGITAT(p)        ((p) != end && ISDIGIT(*(p)))
+
 static int lept_parse_number(lept_context* c, lept_value* v) {
-    const char* p = c->json;
-    if (*p == '-') p++;
-    if (*p == '0') p++;
+    const char* p = c->json, *end = c->end;
+    const char *i, *ie, *f, *fe;
+    int exp = 0, ret;
+    if (p != end && *p == '-') p++;
+    i = p;
+    if (p != end && *p == '0') p++;
     else {
-        if (!ISDIGIT1TO9(*p)) return LEPT_PARSE_INVALID_VALUE;
-        for (p++; ISDIGIT(*p); p++);
+        if (p == end || !ISDIGIT1TO9(*p)) return LEPT_PARSE_INVALID_VALUE;
+        for (p++; ISDIGITAT(p); p++);
     }
-    if (*p == '.') {
+    ie = f = fe = p;
+    if (p != end && *p == '.') {
         p++;
-        if (!ISDIGIT(*p)) return LEPT_PARSE_INVALID_VALUE;
-        for (p++; ISDIGIT(*p); p++);
+        if (!ISDIGITAT(p)) return LEPT_PARSE_INVALID_VALUE;
+        f = p;
+        for (p++; ISDIGITAT(p); p++);
+        fe = p;
     }
-    if (*p == 'e' || *p == 'E') {
+    if (p != end && (*p == 'e' || *p == 'E')) {
+        int minus = 0;
         p++;
-        if (*p == '+' || *p == '-') p++;
-        if (!ISDIGIT(*p)) return LEPT_PARSE_INVALID_VALUE;
-        for (p++; ISDIGIT(*p); p++);
+        if (p != end && (*p == '+' || *p == '-')) minus = *p++ == '-';
+        if (!ISDIGITAT(p)) return LEPT_PARSE_INVALID_VALUE;
+        for (; ISDIGITAT(p); p++)
+            if (exp < 100000) /* far beyond the range of double, only avoid overflow */
+                exp = exp * 10 + (*p - '0');
+        if (minus)
+            exp = -exp;
     }
-    errno = 0;
-    v->u.n = strtod(c->json, NULL);
-    if (errno == ERANGE && (v->u.n == HUGE_VAL || v->u.n == -HUGE_VAL))
-        return LEPT_PARSE_NUMBER_TOO_BIG;
+    if (c->lazy & LEPT_PARSE_LAZY_NUMBER_FLAG) {
+        if ((size_t)(p - c->json) > LEPT_LENGTH_MAX)
+            return LEPT_PARSE_TOO_LONG;
+        v->u.s.s = (char*)c->json;
+        v->u.s.len = p - c->json;
+        v->type = LEPT_NUMBER;
+        v->flags |= LEPT_LAZY_NUMBER;
+        c->json = p;
+        return LEPT_PARSE_OK;
+    }
+    if (ie == p && lept_parse_int64(i, ie, *c->json == '-', v)) {
+        c->json = p;
+        return LEPT_PARSE_OK;
+    }
+    if ((ret = lept_strtod(i, ie, f, fe, exp, &v->u.n)) != LEPT_PARSE_OK)
+        return ret;
+    if (*c->json == '-')
+        v->u.n = -v->u.n;
     v->type = LEPT_NUMBER;
     c->json = p;
     return LEPT_PARSE_OK;
 }
 
-static const char* lept_parse_hex4(const char* p, unsigned* u) {
+/* Converts a lazy number in place, unless it is too big for a double */
+static void lept_number_materialize(lept_value* v) {
+    lept_context c;
+    lept_value n;
+    c.json = v->u.s.s;
+    c.end = v->u.s.s + v->u.s.len;
+    c.lazy = 0;
+    c.index = NULL;
+    lept_init(&n);
+    if (lept_parse_number(&c, &n) == LEPT_PARSE_OK)
+        *v = n;
+}
+
+static const char* lept_parse_hex4(const char* p, const char* end, unsigned* u) {
     int i;
     *u = 0;
+    if (end - p < 4)
+        return NULL;
     for (i = 0; i < 4; i++) {
         char ch = *p++;
         *u <<= 4;
@@ -132,22 +1040,78 @@ static void lept_encode_utf8(lept_context* c, unsigned u) {
 }
 
 #define STRING_ERROR(ret) do { c->top = head; return ret; } while(0)
+#define ISSTRINGSTOP(ch)    ((ch) == '\"' || (ch) == '\\' || (unsigned char)(ch) < 0x20)
+
+#ifdef LEPT_SSE2
+/* Find the first '"', '\\' or control character 16 bytes at a time */
+static const char* lept_scan_string_sse2(const char* p, const char* end) {
+    const __m128i quote = _mm_set1_epi8('\"'), backslash = _mm_set1_epi8('\\'), control = _mm_set1_epi8(0x1F);
+    for (; end - p >= 16; p += 16) {
+        const __m128i s = _mm_loadu_si128((const __m128i*)p);
+        __m128i x = _mm_cmpeq_epi8(s, quote);
+        unsigned mask;
+        x = _mm_or_si128(x, _mm_cmpeq_epi8(s, backslash));
+        x = _mm_or_si128(x, _mm_cmpeq_epi8(_mm_max_epu8(s, control), control)); /* s <= 0x1F, unsigned */
+        mask = (unsigned)_mm_movemask_epi8(x);
+        if (mask != 0)
+            return p + lept_ctz(mask);
+    }
+    while (p != end && !ISSTRINGSTOP(*p))
+        p++;
+    return p;
+}
+#endif
+
+/* Skip the run of characters that can be copied verbatim, up to end at most */
+static const char* lept_scan_string(const char* p, const char* end) {
+#ifdef LEPT_SSE2
+    return lept_scan_string_sse2(p, end);
+#else
+    while (p != end && !ISSTRINGSTOP(*p))
+        p++;
+    return p;
+#endif
+}
 
-static int lept_parse_string_raw(lept_context* c, char** str, size_t* len) {
+/*
+ * On success *str points to the decoded string, which is either the input itself (no escapes) or the top of the stack.
+ * Either way it is only valid until the next push, so the caller copies it out.
+ */
+static int lept_parse_string_raw(lept_context* c, const char** str, size_t* len) {
     size_t head = c->top;
     unsigned u, u2;
-    const char* p;
+    const char* p, *end = c->end;
+    if (c->index != NULL && (p = lept_index_string(c->index, c->json)) != NULL) {
+        *str = c->json + 1;
+        *len = p - *str;
+        c->json = p + 1;
+        return LEPT_PARSE_OK;
+    }
     EXPECT(c, '\"');
     p = c->json;
     for (;;) {
-        char ch = *p++;
-        switch (ch) {
+        const char* q = lept_scan_string(p, end);
+        if (q == end)
+            STRING_ERROR(LEPT_PARSE_MISS_QUOTATION_MARK);
+        if (*q == '\"' && c->top == head) {
+            *len = q - p;
+            *str = p;
+            c->json = q + 1;
+            return LEPT_PARSE_OK;
+        }
+        if (q != p) {
+            PUTS(c, p, q - p);
+            p = q;
+        }
+        switch (*p++) {
             case '\"':
                 *len = c->top - head;
                 *str = lept_context_pop(c, *len);
                 c->json = p;
                 return LEPT_PARSE_OK;
             case '\\':
+                if (p == end)
+                    STRING_ERROR(LEPT_PARSE_MISS_QUOTATION_MARK);
                 switch (*p++) {
                     case '\"': PUTC(c, '\"'); break;
                     case '\\': PUTC(c, '\\'); break;
@@ -158,14 +1122,12 @@ static int lept_parse_string_raw(lept_context* c, char** str, size_t* len) {
                     case 'r':  PUTC(c, '\r'); break;
                     case 't':  PUTC(c, '\t'); break;
                     case 'u':
-                        if (!(p = lept_parse_hex4(p, &u)))
+                        if (!(p = lept_parse_hex4(p, end, &u)))
                             STRING_ERROR(LEPT_PARSE_INVALID_UNICODE_HEX);
                         if (u >= 0xD800 && u <= 0xDBFF) { /* surrogate pair */
-                            if (*p++ != '\\')
-                                STRING_ERROR(LEPT_PARSE_INVALID_UNICODE_SURROGATE);
-                            if (*p++ != 'u')
+                            if (end - p < 2 || p[0] != '\\' || p[1] != 'u')
                                 STRING_ERROR(LEPT_PARSE_INVALID_UNICODE_SURROGATE);
-                            if (!(p = lept_parse_hex4(p, &u2)))
+                            if (!(p = lept_parse_hex4(p + 2, end, &u2)))
                                 STRING_ERROR(LEPT_PARSE_INVALID_UNICODE_HEX);
                             if (u2 < 0xDC00 || u2 > 0xDFFF)
                                 STRING_ERROR(LEPT_PARSE_INVALID_UNICODE_SURROGATE);
@@ -177,22 +1139,50 @@ static int lept_parse_string_raw(lept_context* c, char** str, size_t* len) {
                         STRING_ERROR(LEPT_PARSE_INVALID_STRING_ESCAPE);
                 }
                 break;
-            case '\0':
-                STRING_ERROR(LEPT_PARSE_MISS_QUOTATION_MARK);
-            default:
-                if ((unsigned char)ch < 0x20)
-                    STRING_ERROR(LEPT_PARSE_INVALID_STRING_CHAR);
-                PUTC(c, ch);
+            default: /* lept_scan_string() stops at nothing else */
+                STRING_ERROR(LEPT_PARSE_INVALID_STRING_CHAR);
         }
     }
 }
 
+/* In-situ mode: the decoded string is never longer than its source, so it is moved over it and terminated there */
+static char* lept_insitu_string(char* dst, const char* s, size_t len) {
+    if (s != dst)
+        memcpy(dst, s, len);
+    dst[len] = '\0';
+    return dst;
+}
+
 static int lept_parse_string(lept_context* c, lept_value* v) {
     int ret;
-    char* s;
+    const char* s;
+    char* dst = (char*)c->json + 1;
     size_t len;
-    if ((ret = lept_parse_string_raw(c, &s, &len)) == LEPT_PARSE_OK)
-        lept_set_string(v, s, len);
+    if ((ret = lept_parse_string_raw(c, &s, &len)) == LEPT_PARSE_OK) {
+        if (len > LEPT_LENGTH_MAX)
+            ret = LEPT_PARSE_TOO_LONG;
+        else if (c->insitu) {
+            v->u.s.s = lept_insitu_string(dst, s, len);
+            v->u.s.len = len;
+            v->type = LEPT_STRING;
+            v->flags |= LEPT_SHARED_STRING;
+        }
+        else if ((c->lazy & LEPT_PARSE_LAZY_STRING_FLAG) && s == dst && len > LEPT_INLINE_MAX) {
+            v->u.s.s = dst; /* only read, and copied when a terminator is needed */
+            v->u.s.len = len;
+            v->type = LEPT_STRING;
+            v->flags |= LEPT_LAZY_STRING;
+        }
+        else if (c->arena != NULL && len > LEPT_INLINE_MAX) {
+            memcpy(v->u.s.s = (char*)lept_context_alloc(c, len + 1), s, len);
+            v->u.s.s[len] = '\0';
+            v->u.s.len = len;
+            v->type = LEPT_STRING;
+            v->flags |= LEPT_ARENA;
+        }
+        else
+            lept_set_string_with(v, s, len, c->allocator);
+    }
     return ret;
 }
 
@@ -203,7 +1193,7 @@ static int lept_parse_array(lept_context* c, lept_value* v) {
     int ret;
     EXPECT(c, '[');
     lept_parse_whitespace(c);
-    if (*c->json == ']') {
+    if (PEEK(c) == ']') {
         c->json++;
         v->type = LEPT_ARRAY;
         v->u.a.size = 0;
@@ -218,16 +1208,22 @@ static int lept_parse_array(lept_context* c, lept_value* v) {
         memcpy(lept_context_push(c, sizeof(lept_value)), &e, sizeof(lept_value));
         size++;
         lept_parse_whitespace(c);
-        if (*c->json == ',') {
+        if (PEEK(c) == ',') {
             c->json++;
             lept_parse_whitespace(c);
         }
-        else if (*c->json == ']') {
+        else if (PEEK(c) == ']') {
+            if (size > LEPT_LENGTH_MAX) {
+                ret = LEPT_PARSE_TOO_LONG;
+                break;
+            }
             c->json++;
             v->type = LEPT_ARRAY;
             v->u.a.size = size;
             size *= sizeof(lept_value);
-            memcpy(v->u.a.e = (lept_value*)malloc(size), lept_context_pop(c, size), size);
+            memcpy(v->u.a.e = (lept_value*)lept_context_alloc(c, size), lept_context_pop(c, size), size);
+            if (c->arena != NULL)
+                v->flags |= LEPT_ARENA;
             return LEPT_PARSE_OK;
         }
         else {
@@ -237,7 +1233,7 @@ static int lept_parse_array(lept_context* c, lept_value* v) {
     }
     /* Pop and free values on the stack */
     for (i = 0; i < size; i++)
-        lept_free((lept_value*)lept_context_pop(c, sizeof(lept_value)));
+        lept_free_with((lept_value*)lept_context_pop(c, sizeof(lept_value)), c->allocator);
     return ret;
 }
 
@@ -247,7 +1243,7 @@ static int lept_parse_object(lept_context* c, lept_value* v) {
     int ret;
     EXPECT(c, '{');
     lept_parse_whitespace(c);
-    if (*c->json == '}') {
+    if (PEEK(c) == '}') {
         c->json++;
         v->type = LEPT_OBJECT;
         v->u.o.m = 0;
@@ -257,20 +1253,25 @@ static int lept_parse_object(lept_context* c, lept_value* v) {
     m.k = NULL;
     size = 0;
     for (;;) {
-        char* str;
+        const char* str;
+        char* dst = (char*)c->json + 1;
         lept_init(&m.v);
         /* parse key */
-        if (*c->json != '"') {
+        if (PEEK(c) != '"') {
             ret = LEPT_PARSE_MISS_KEY;
             break;
         }
         if ((ret = lept_parse_string_raw(c, &str, &m.klen)) != LEPT_PARSE_OK)
             break;
-        memcpy(m.k = (char*)malloc(m.klen + 1), str, m.klen);
-        m.k[m.klen] = '\0';
+        if (c->insitu)
+            m.k = lept_insitu_string(dst, str, m.klen);
+        else {
+            memcpy(m.k = (char*)lept_context_alloc(c, m.klen + 1), str, m.klen);
+            m.k[m.klen] = '\0';
+        }
         /* parse ws colon ws */
         lept_parse_whitespace(c);
-        if (*c->json != ':') {
+        if (PEEK(c) != ':') {
             ret = LEPT_PARSE_MISS_COLON;
             break;
         }
@@ -284,16 +1285,19 @@ static int lept_parse_object(lept_context* c, lept_value* v) {
         m.k = NULL; /* ownership is transferred to member on stack */
         /* parse ws [comma | right-curly-brace] ws */
         lept_parse_whitespace(c);
-        if (*c->json == ',') {
+        if (PEEK(c) == ',') {
             c->json++;
             lept_parse_whitespace(c);
         }
-        else if (*c->json == '}') {
-            size_t s = sizeof(lept_member) * size;
+        else if (PEEK(c) == '}') {
+            if (size > LEPT_LENGTH_MAX) {
+                ret = LEPT_PARSE_TOO_LONG;
+                break;
+            }
             c->json++;
-            v->type = LEPT_OBJECT;
-            v->u.o.size = size;
-            memcpy(v->u.o.m = (lept_member*)malloc(s), lept_context_pop(c, s), s);
+            lept_context_pop_object(c, v, size);
+            if (c->insitu)
+                v->flags |= LEPT_SHARED_STRING;
             return LEPT_PARSE_OK;
         }
         else {
@@ -302,21 +1306,23 @@ static int lept_parse_object(lept_context* c, lept_value* v) {
         }
     }
     /* Pop and free members on the stack */
-    free(m.k);
+    if (!c->insitu)
+        lept_context_free(c, m.k);
     for (i = 0; i < size; i++) {
         lept_member* m = (lept_member*)lept_context_pop(c, sizeof(lept_member));
-        free(m->k);
-        lept_free(&m->v);
+        if (!c->insitu)
+            lept_context_free(c, m->k);
+        lept_free_with(&m->v, c->allocator);
     }
     v->type = LEPT_NULL;
     return ret;
 }
 
 static int lept_parse_value(lept_context* c, lept_value* v) {
-    switch (*c->json) {
-        case 't':  return lept_parse_literal(c, v, "true", LEPT_TRUE);
-        case 'f':  return lept_parse_literal(c, v, "false", LEPT_FALSE);
-        case 'n':  return lept_parse_literal(c, v, "null", LEPT_NULL);
+    switch (PEEK(c)) {
+        case 't':  return lept_parse_literal(c, v, "true", 4, LEPT_TRUE);
+        case 'f':  return lept_parse_literal(c, v, "false", 5, LEPT_FALSE);
+        case 'n':  return lept_parse_literal(c, v, "null", 4, LEPT_NULL);
         default:   return lept_parse_number(c, v);
         case '"':  return lept_parse_string(c, v);
         case '[':  return lept_parse_array(c, v);
@@ -325,39 +1331,1653 @@ static int lept_parse_value(lept_context* c, lept_value* v) {
     }
 }
 
+/* Parses on the stack of c, which the caller owns and may keep for the next parse */
+static int lept_parse_root(lept_context* c, lept_value* v) {
+    int ret;
+    lept_init(v);
+    lept_parse_whitespace(c);
+    if ((ret = lept_parse_value(c, v)) == LEPT_PARSE_OK) {
+        lept_parse_whitespace(c);
+        if (c->json != c->end) {
+            lept_free_with(v, c->allocator);
+            ret = LEPT_PARSE_ROOT_NOT_SINGULAR;
+        }
+    }
+    assert(c->top == 0);
+    return ret;
+}
+
+/* Parses the whole input of c in two stages, or in one if it cannot be indexed */
+static int lept_parse_indexed(lept_context* c, lept_value* v) {
+    lept_index x;
+    int ret;
+    if (!lept_index_init(&x, c->json, c->end - c->json, c->allocator))
+        return lept_parse_root(c, v);
+    c->index = &x;
+    ret = lept_parse_root(c, v);
+    c->index = NULL;
+    LEPT_FREE(c->allocator, x.pos);
+    return ret;
+}
+
 int lept_parse(lept_value* v, const char* json) {
+    assert(json != NULL);
+    return lept_parse_n(v, json, strlen(json));
+}
+
+int lept_parse_n(lept_value* v, const char* json, size_t len) {
+    return lept_parse_with(v, json, len, NULL);
+}
+
+/* Parses json[0..len), leaving the values selected by lazy pointing into it, in two stages with LEPT_PARSE_INDEX_FLAG */
+static int lept_parse_lazy(lept_value* v, const char* json, size_t len, const lept_allocator* a, unsigned lazy) {
     lept_context c;
     int ret;
-    assert(v != NULL);
+    assert(v != NULL && (json != NULL || len == 0));
     c.json = json;
+    c.end = json + len;
+    c.insitu = 0;
+    c.lazy = lazy & LEPT_PARSE_LAZY_FLAGS;
+    c.index = NULL;
+    c.arena = NULL;
+    c.allocator = LEPT_ALLOCATOR(a);
     c.stack = NULL;
     c.size = c.top = 0;
-    lept_init(v);
-    lept_parse_whitespace(&c);
-    if ((ret = lept_parse_value(&c, v)) == LEPT_PARSE_OK) {
-        lept_parse_whitespace(&c);
-        if (*c.json != '\0') {
-            v->type = LEPT_NULL;
-            ret = LEPT_PARSE_ROOT_NOT_SINGULAR;
-        }
-    }
-    assert(c.top == 0);
-    free(c.stack);
+    ret = lazy & LEPT_PARSE_INDEX_FLAG ? lept_parse_indexed(&c, v) : lept_parse_root(&c, v);
+    LEPT_FREE(c.allocator, c.stack);
     return ret;
 }
 
-#if 0
-// Unoptimized
-static void lept_stringify_string(lept_context* c, const char* s, size_t len) {
-    size_t i;
-    assert(s != NULL);
-    PUTC(c, '"');
-    for (i = 0; i < len; i++) {
-        unsigned char ch = (unsigned char)s[i];
-        switch (ch) {
-            case '\"': PUTS(c, "\\\"", 2); break;
-            case '\\': PUTS(c, "\\\\", 2); break;
-            case '\b': PUTS(c, "\\b",  2); break;
+int lept_parse_with(lept_value* v, const char* json, size_t len, const lept_allocator* a) {
+    return lept_parse_lazy(v, json, len, a, 0);
+}
+
+int lept_parse_insitu(lept_value* v, char* json, size_t len) {
+    return lept_parse_insitu_with(v, json, len, NULL);
+}
+
+int lept_parse_insitu_with(lept_value* v, char* json, size_t len, const lept_allocator* a) {
+    lept_context c;
+    int ret;
+    assert(v != NULL && (json != NULL || len == 0));
+    c.json = json;
+    c.end = json + len;
+    c.insitu = 1;
+    c.lazy = 0;
+    c.index = NULL;
+    c.arena = NULL;
+    c.allocator = LEPT_ALLOCATOR(a);
+    c.stack = NULL;
+    c.size = c.top = 0;
+    ret = lept_parse_root(&c, v);
+    LEPT_FREE(c.allocator, c.stack);
+    return ret;
+}
+
+struct lept_document {
+    lept_value root;
+    lept_arena arena;
+    char* stack; size_t size;   /* parse stack, kept between parses */
+};
+
+lept_document* lept_document_create(void) {
+    return lept_document_create_with(NULL);
+}
+
+lept_document* lept_document_create_with(const lept_allocator* a) {
+    lept_document* d;
+    a = LEPT_ALLOCATOR(a);
+    d = (lept_document*)LEPT_MALLOC(a, sizeof(lept_document));
+    lept_init(&d->root);
+    d->arena.blocks = NULL;
+    d->arena.p = d->arena.end = NULL;
+    d->arena.allocator = a;
+    d->stack = NULL;
+    d->size = 0;
+    return d;
+}
+
+void lept_document_destroy(lept_document* d) {
+    const lept_allocator* a;
+    assert(d != NULL);
+    a = d->arena.allocator;
+    lept_arena_free(&d->arena);
+    LEPT_FREE(a, d->stack);
+    LEPT_FREE(a, d);
+}
+
+int lept_document_parse(lept_document* d, const char* json, size_t len) {
+    lept_context c;
+    int ret;
+    assert(d != NULL && (json != NULL || len == 0));
+    lept_arena_reset(&d->arena);
+    c.json = json;
+    c.end = json + len;
+    c.insitu = 0;
+    c.lazy = 0;
+    c.index = NULL;
+    c.arena = &d->arena;
+    c.allocator = d->arena.allocator;
+    c.stack = d->stack;
+    c.size = d->size;
+    c.top = 0;
+    ret = lept_parse_root(&c, &d->root);
+    d->stack = c.stack;
+    d->size = c.size;
+    return ret;
+}
+
+const lept_value* lept_document_root(const lept_document* d) {
+    assert(d != NULL);
+    return &d->root;
+}
+
+/* Parallel parsing: fork-join over threads, each task parsing its own part of the input with its own context */
+
+typedef void (*lept_task)(void* arg, unsigned i);
+
+typedef struct {
+    lept_task fn;
+    void* arg;
+    unsigned i;
+}lept_thread;
+
+#if defined(LEPT_PTHREADS)
+static void* lept_thread_run(void* t) {
+    ((lept_thread*)t)->fn(((lept_thread*)t)->arg, ((lept_thread*)t)->i);
+    return NULL;
+}
+#elif defined(LEPT_WIN32_THREADS)
+static DWORD WINAPI lept_thread_run(LPVOID t) {
+    ((lept_thread*)t)->fn(((lept_thread*)t)->arg, ((lept_thread*)t)->i);
+    return 0;
+}
+#endif
+
+static unsigned lept_cpu_count(void) {
+#if defined(LEPT_PTHREADS) && defined(_SC_NPROCESSORS_ONLN)
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (unsigned)n : 1;
+#elif defined(LEPT_WIN32_THREADS)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (unsigned)info.dwNumberOfProcessors;
+#else
+    return 1;
+#endif
+}
+
+/* Tasks for `threads` threads (0 for one per CPU), fewer if the input is too small to be worth splitting */
+static unsigned lept_task_count(unsigned threads, size_t len) {
+    size_t n = len / LEPT_PARALLEL_MIN_SIZE + 1;
+    if (threads == 0)
+        threads = lept_cpu_count();
+    return n < threads ? (unsigned)n : threads;
+}
+
+/* Runs fn(arg, i) for every i < n, each on its own thread with task 0 on the caller's, and waits for all of them */
+static void lept_parallel(unsigned n, lept_task fn, void* arg) {
+#if defined(LEPT_PTHREADS) || defined(LEPT_WIN32_THREADS)
+    lept_thread* t;
+#if defined(LEPT_PTHREADS)
+    pthread_t* h;
+#else
+    HANDLE* h;
+#endif
+    unsigned i;
+    if (n <= 1) {
+        if (n == 1)
+            fn(arg, 0);
+        return;
+    }
+    t = (lept_thread*)LEPT_MALLOC(&lept_std_allocator, n * sizeof(lept_thread));
+    h = LEPT_MALLOC(&lept_std_allocator, n * sizeof(*h));
+    for (i = 1; i < n; i++) {
+        t[i].fn = fn;
+        t[i].arg = arg;
+        t[i].i = i;
+#if defined(LEPT_PTHREADS)
+        if (pthread_create(&h[i], NULL, lept_thread_run, &t[i]) != 0)
+#else
+        if ((h[i] = CreateThread(NULL, 0, lept_thread_run, &t[i], 0, NULL)) == NULL)
+#endif
+        {
+            t[i].fn = NULL; /* no thread, run it here */
+            fn(arg, i);
+        }
+    }
+    fn(arg, 0);
+    for (i = 1; i < n; i++) {
+        if (t[i].fn == NULL)
+            continue;
+#if defined(LEPT_PTHREADS)
+        pthread_join(h[i], NULL);
+#else
+        WaitForSingleObject(h[i], INFINITE);
+        CloseHandle(h[i]);
+#endif
+    }
+    LEPT_FREE(&lept_std_allocator, h);
+    LEPT_FREE(&lept_std_allocator, t);
+#else
+    unsigned i;
+    for (i = 0; i < n; i++)
+        fn(arg, i);
+#endif
+}
+
+/* Concatenates the values on the stacks of n parts into array v, in part order, and frees the stacks */
+static void lept_parallel_join(lept_value* v, lept_context* parts, unsigned n) {
+    size_t size = 0;
+    unsigned i;
+    char* e;
+    for (i = 0; i < n; i++)
+        size += parts[i].top;
+    v->type = LEPT_ARRAY;
+    v->u.a.size = size / sizeof(lept_value);
+    v->u.a.e = NULL;
+    if (size > 0)
+        v->u.a.e = (lept_value*)LEPT_MALLOC(&lept_std_allocator, size);
+    for (i = 0, e = (char*)v->u.a.e; i < n; i++) {
+        if (parts[i].top > 0)
+            memcpy(e, parts[i].stack, parts[i].top);
+        e += parts[i].top;
+        LEPT_FREE(&lept_std_allocator, parts[i].stack);
+    }
+}
+
+static void lept_parallel_free(lept_context* parts, unsigned n) {
+    unsigned i;
+    for (i = 0; i < n; i++) {
+        while (parts[i].top > 0)
+            lept_free((lept_value*)lept_context_pop(&parts[i], sizeof(lept_value)));
+        LEPT_FREE(&lept_std_allocator, parts[i].stack);
+    }
+}
+
+/* Parts of the input parsed by the tasks, each into a stack of values */
+typedef struct {
+    lept_context* values;       /* input range and parsed values of each part */
+    size_t* lines;              /* NDJSON: lines read by each part */
+    int* errors;                /* error of each part, at line lines[i] for NDJSON */
+    unsigned n;
+}lept_parts;
+
+static void lept_parts_init(lept_parts* parts, unsigned n) {
+    unsigned i;
+    parts->values = (lept_context*)LEPT_MALLOC(&lept_std_allocator, n * sizeof(lept_context));
+    parts->lines = (size_t*)LEPT_MALLOC(&lept_std_allocator, n * sizeof(size_t));
+    parts->errors = (int*)LEPT_MALLOC(&lept_std_allocator, n * sizeof(int));
+    parts->n = n;
+    for (i = 0; i < n; i++) {
+        parts->values[i].stack = NULL;
+        parts->values[i].size = parts->values[i].top = 0;
+        parts->values[i].allocator = &lept_std_allocator;
+        parts->values[i].lazy = 0;
+        parts->lines[i] = 0;
+        parts->errors[i] = LEPT_PARSE_OK;
+    }
+}
+
+/* Makes v the array of the values of all parts in order, unless one failed; frees the parts and returns the first error */
+static int lept_parts_finish(lept_parts* parts, lept_value* v, size_t* error_line) {
+    size_t line = 0, size = 0;
+    unsigned i;
+    int ret = LEPT_PARSE_OK;
+    for (i = 0; i < parts->n; i++) {
+        if ((ret = parts->errors[i]) != LEPT_PARSE_OK) {
+            if (error_line != NULL)
+                *error_line = line + parts->lines[i];
+            break;
+        }
+        line += parts->lines[i];
+        size += parts->values[i].top / sizeof(lept_value);
+    }
+    if (ret == LEPT_PARSE_OK && size > LEPT_LENGTH_MAX) {
+        ret = LEPT_PARSE_TOO_LONG;
+        if (error_line != NULL)
+            *error_line = line;
+    }
+    lept_init(v);
+    if (ret == LEPT_PARSE_OK)
+        lept_parallel_join(v, parts->values, parts->n);
+    else
+        lept_parallel_free(parts->values, parts->n);
+    LEPT_FREE(&lept_std_allocator, parts->values);
+    LEPT_FREE(&lept_std_allocator, parts->lines);
+    LEPT_FREE(&lept_std_allocator, parts->errors);
+    return ret;
+}
+
+static void lept_task_context(lept_context* c, const lept_context* part) {
+    c->json = part->json;
+    c->end = part->end;
+    c->insitu = 0;
+    c->lazy = part->lazy & LEPT_PARSE_LAZY_FLAGS;
+    c->index = NULL;
+    c->arena = NULL;
+    c->allocator = &lept_std_allocator;
+    c->stack = NULL;
+    c->size = c->top = 0;
+}
+
+/* NDJSON: the input is split at newlines into one part per task, each parsed line by line */
+
+static void lept_ndjson_task(void* arg, unsigned i) {
+    lept_parts* parts = (lept_parts*)arg;
+    lept_context* part = &parts->values[i], c;
+    const char* p = part->json, *eol;
+    lept_value v;
+    lept_task_context(&c, part);
+    for (; p != part->end; parts->lines[i]++) {
+        if ((eol = (const char*)memchr(p, '\n', part->end - p)) == NULL)
+            eol = part->end;
+        c.json = p;
+        c.end = eol;
+        lept_parse_whitespace(&c);
+        if (c.json != c.end) { /* blank lines are skipped */
+            if ((parts->errors[i] = lept_parse_root(&c, &v)) != LEPT_PARSE_OK)
+                break;
+            memcpy(lept_context_push(part, sizeof(lept_value)), &v, sizeof(lept_value));
+        }
+        p = eol != part->end ? eol + 1 : part->end;
+    }
+    LEPT_FREE(c.allocator, c.stack);
+}
+
+int lept_parse_ndjson(lept_value* v, const char* json, size_t len, unsigned threads, size_t* error_line) {
+    lept_parts parts;
+    const char* p, *end = json + len;
+    unsigned n, i;
+    assert(v != NULL && (json != NULL || len == 0));
+    n = lept_task_count(threads, len);
+    lept_parts_init(&parts, n);
+    for (i = 0, p = json; i < n; i++) {
+        const char* q = json + len / n * (i + 1);
+        if (i == n - 1)
+            q = end;
+        else if (q <= p || (q = (const char*)memchr(q, '\n', end - q)) == NULL)
+            q = p; /* this part is empty, the previous line runs past it */
+        else
+            q++;
+        parts.values[i].json = p;
+        parts.values[i].end = p = q;
+    }
+    lept_parallel(n, lept_ndjson_task, &parts);
+    return lept_parts_finish(&parts, v, error_line);
+}
+
+/* Top-level arrays: a pre-scan splits the elements into one part per task, each part but the last ending in a comma */
+
+static void lept_array_task(void* arg, unsigned i) {
+    lept_parts* parts = (lept_parts*)arg;
+    lept_context* part = &parts->values[i], c;
+    lept_value v;
+    int last = i == parts->n - 1, ret;
+    lept_task_context(&c, part);
+    for (;;) {
+        lept_parse_whitespace(&c);
+        lept_init(&v);
+        if ((ret = lept_parse_value(&c, &v)) != LEPT_PARSE_OK)
+            break;
+        memcpy(lept_context_push(part, sizeof(lept_value)), &v, sizeof(lept_value));
+        lept_parse_whitespace(&c);
+        if (PEEK(&c) == ',') {
+            if (++c.json == c.end && !last)
+                break;
+        }
+        else {
+            if (!last || PEEK(&c) != ']')
+                ret = LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+            else {
+                c.json++;
+                lept_parse_whitespace(&c);
+                if (c.json != c.end)
+                    ret = LEPT_PARSE_ROOT_NOT_SINGULAR;
+            }
+            break;
+        }
+    }
+    parts->errors[i] = ret;
+    LEPT_FREE(c.allocator, c.stack);
+}
+
+/* Splits the elements of the array at json at up to n - 1 commas, the first ones after each n-th of the input */
+static unsigned lept_array_split(lept_context* values, unsigned n, const char* json, const char* end) {
+    const char* p = json + 1;
+    size_t depth = 0, len = end - json;
+    unsigned k = 1;
+    values[0].json = p;
+    while (p != end && k < n) {
+        switch (*p++) {
+            case '"':
+                while ((p = lept_scan_string(p, end)) != end && *p++ != '"')
+                    if (p[-1] == '\\' && p != end)
+                        p++;
+                break;
+            case '[': case '{': depth++; break;
+            case ']': case '}':
+                if (depth-- == 0)
+                    return k;
+                break;
+            case ',':
+                if (depth == 0 && (size_t)(p - json) >= len / n * k) {
+                    values[k - 1].end = values[k].json = p;
+                    k++;
+                }
+        }
+    }
+    return k;
+}
+
+static int lept_parse_parallel_lazy(lept_value* v, const char* json, size_t len, unsigned threads, unsigned lazy) {
+    lept_context c;
+    lept_parts parts;
+    unsigned n, i;
+    assert(v != NULL && (json != NULL || len == 0));
+    c.json = json;
+    c.end = json + len;
+    c.index = NULL;
+    lept_parse_whitespace(&c);
+    if ((n = lept_task_count(threads, len)) <= 1 || PEEK(&c) != '[')
+        return lept_parse_lazy(v, json, len, NULL, lazy);
+    lept_parts_init(&parts, n);
+    parts.n = lept_array_split(parts.values, n, c.json, c.end);
+    parts.values[parts.n - 1].end = c.end;
+    for (i = 0; i < parts.n; i++)
+        parts.values[i].lazy = lazy;
+    lept_parallel(parts.n, lept_array_task, &parts);
+    if (lept_parts_finish(&parts, v, NULL) == LEPT_PARSE_OK)
+        return LEPT_PARSE_OK;
+    /* the error a serial parse gives, which the pre-scan may also have been misled about */
+    return lept_parse_lazy(v, json, len, NULL, lazy);
+}
+
+int lept_parse_parallel(lept_value* v, const char* json, size_t len, unsigned threads) {
+    return lept_parse_parallel_lazy(v, json, len, threads, 0);
+}
+
+int lept_parse_flags(lept_value* v, const char* json, size_t len, unsigned flags) {
+    return lept_parse_flags_with(v, json, len, flags, NULL);
+}
+
+int lept_parse_flags_with(lept_value* v, const char* json, size_t len, unsigned flags, const lept_allocator* a) {
+    unsigned lazy = flags & (LEPT_PARSE_LAZY_FLAGS | LEPT_PARSE_INDEX_FLAG);
+    if (a != NULL)
+        lazy &= ~LEPT_PARSE_LAZY_STRING_FLAG; /* lept_get_string() copies with malloc(), not with a */
+    if ((flags & LEPT_PARSE_PARALLEL_FLAG) && a == NULL) /* a user allocator is not known to be thread-safe */
+        return lept_parse_parallel_lazy(v, json, len, 0, lazy);
+    return lept_parse_lazy(v, json, len, a, lazy);
+}
+
+/* Batches: consecutive documents per task, parsed on one stack and, with a document, into one arena per task */
+
+typedef struct {
+    const char* const* docs;
+    const size_t* lens;
+    lept_value* results;
+    int* errors;
+    size_t n;
+    unsigned tasks;
+    lept_arena* arenas;         /* of each task, NULL without a document */
+    size_t* failed;             /* documents that failed in each task */
+}lept_batch;
+
+static void lept_batch_task(void* arg, unsigned t) {
+    lept_batch* b = (lept_batch*)arg;
+    size_t step = b->n / b->tasks, extra = b->n % b->tasks;
+    size_t i = step * t + (t < extra ? t : extra), end = i + step + (t < extra);
+    lept_context c;
+    int ret;
+    c.insitu = 0;
+    c.lazy = 0;
+    c.index = NULL;
+    c.arena = b->arenas != NULL ? &b->arenas[t] : NULL;
+    c.allocator = c.arena != NULL ? c.arena->allocator : &lept_std_allocator;
+    c.stack = NULL;
+    c.size = c.top = 0;
+    b->failed[t] = 0;
+    for (; i < end; i++) {
+        assert(b->docs[i] != NULL || b->lens[i] == 0);
+        c.json = b->docs[i];
+        c.end = b->docs[i] + b->lens[i];
+        if ((ret = lept_parse_root(&c, &b->results[i])) != LEPT_PARSE_OK)
+            b->failed[t]++;
+        if (b->errors != NULL)
+            b->errors[i] = ret;
+    }
+    LEPT_FREE(c.allocator, c.stack);
+}
+
+size_t lept_parse_batch(lept_document* d, const char* const* docs, const size_t* lens, size_t n,
+    lept_value* results, int* errors, unsigned threads) {
+    lept_batch b;
+    size_t len = 0, failed = 0, i;
+    unsigned t;
+    assert((docs != NULL && lens != NULL && results != NULL) || n == 0);
+    for (i = 0; i < n; i++)
+        len += lens[i];
+    b.docs = docs;
+    b.lens = lens;
+    b.results = results;
+    b.errors = errors;
+    b.n = n;
+    b.tasks = lept_task_count(threads, len);
+    if (b.tasks > n)
+        b.tasks = n > 0 ? (unsigned)n : 1;
+    if (d != NULL && d->arena.allocator != &lept_std_allocator)
+        b.tasks = 1; /* a user allocator is not known to be thread-safe */
+    b.arenas = NULL;
+    if (d != NULL) {
+        lept_free_with(&d->root, d->arena.allocator);
+        lept_arena_reset(&d->arena);
+        b.arenas = (lept_arena*)LEPT_MALLOC(&lept_std_allocator, b.tasks * sizeof(lept_arena));
+        b.arenas[0] = d->arena;
+        for (t = 1; t < b.tasks; t++) {
+            b.arenas[t].blocks = NULL;
+            b.arenas[t].p = b.arenas[t].end = NULL;
+            b.arenas[t].allocator = d->arena.allocator;
+        }
+    }
+    b.failed = (size_t*)LEPT_MALLOC(&lept_std_allocator, b.tasks * sizeof(size_t));
+    lept_parallel(b.tasks, lept_batch_task, &b);
+    for (t = 0; t < b.tasks; t++)
+        failed += b.failed[t];
+    if (d != NULL) {
+        /* the blocks of the other tasks go behind the document's current one, and the next reset keeps the largest */
+        d->arena = b.arenas[0];
+        for (t = 1; t < b.tasks; t++) {
+            lept_arena_block* tail = b.arenas[t].blocks;
+            if (tail == NULL)
+                continue;
+            if (d->arena.blocks == NULL) {
+                d->arena = b.arenas[t];
+                continue;
+            }
+            while (tail->next != NULL)
+                tail = tail->next;
+            tail->next = d->arena.blocks->next;
+            d->arena.blocks->next = b.arenas[t].blocks;
+        }
+        LEPT_FREE(&lept_std_allocator, b.arenas);
+    }
+    LEPT_FREE(&lept_std_allocator, b.failed);
+    return failed;
+}
+
+/* Files: parsed straight from a read-only mapping, or read into memory where mapping is not possible */
+
+static int lept_parse_read(lept_value* v, const char* path, unsigned flags, const lept_allocator* a) {
+    lept_context c;
+    FILE* f;
+    size_t n;
+    int ret = LEPT_PARSE_IO_ERROR;
+    lept_init(v);
+    if ((f = fopen(path, "rb")) == NULL)
+        return ret;
+    c.stack = NULL;
+    c.size = c.top = 0;
+    c.allocator = LEPT_ALLOCATOR(a);
+    do {
+        n = fread(lept_context_push(&c, LEPT_FILE_READ_SIZE), 1, LEPT_FILE_READ_SIZE, f);
+        c.top -= LEPT_FILE_READ_SIZE - n;
+    } while (n == LEPT_FILE_READ_SIZE);
+    if (!ferror(f))
+        ret = lept_parse_flags_with(v, c.stack, c.top, flags, a);
+    fclose(f);
+    LEPT_FREE(c.allocator, c.stack);
+    return ret;
+}
+
+int lept_parse_file(lept_value* v, const char* path, unsigned flags) {
+    return lept_parse_file_with(v, path, flags, NULL);
+}
+
+int lept_parse_file_with(lept_value* v, const char* path, unsigned flags, const lept_allocator* a) {
+#if defined(LEPT_POSIX_MMAP)
+    struct stat st;
+    void* p;
+    size_t len;
+    int fd, ret;
+#elif defined(LEPT_WIN32_MMAP)
+    HANDLE f, m;
+    LARGE_INTEGER size;
+    const char* p;
+    int ret;
+#endif
+    assert(v != NULL && path != NULL);
+    flags &= ~LEPT_PARSE_LAZY_FLAGS; /* values cannot point into a file that is closed on return */
+#if defined(LEPT_POSIX_MMAP)
+    if ((fd = open(path, O_RDONLY)) < 0) {
+        lept_init(v);
+        return LEPT_PARSE_IO_ERROR;
+    }
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 && (size_t)st.st_size == (lept_uint64)st.st_size) {
+        len = (size_t)st.st_size;
+        if ((p = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0)) != MAP_FAILED) {
+            close(fd);
+            posix_madvise(p, len, POSIX_MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+            madvise(p, len, MADV_HUGEPAGE);
+#endif
+            ret = lept_parse_flags_with(v, (const char*)p, len, flags, a);
+            munmap(p, len);
+            return ret;
+        }
+    }
+    close(fd);
+#elif defined(LEPT_WIN32_MMAP)
+    f = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (f == INVALID_HANDLE_VALUE) {
+        lept_init(v);
+        return LEPT_PARSE_IO_ERROR;
+    }
+    if (GetFileSizeEx(f, &size) && size.QuadPart > 0 && (size_t)size.QuadPart == (lept_uint64)size.QuadPart) {
+        if ((m = CreateFileMappingA(f, NULL, PAGE_READONLY, 0, 0, NULL)) != NULL) {
+            if ((p = (const char*)MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0)) != NULL) {
+                ret = lept_parse_flags_with(v, p, (size_t)size.QuadPart, flags, a);
+                UnmapViewOfFile(p);
+                CloseHandle(m);
+                CloseHandle(f);
+                return ret;
+            }
+            CloseHandle(m);
+        }
+    }
+    CloseHandle(f);
+#endif
+    return lept_parse_read(v, path, flags, a);
+}
+
+/* SAX: the grammar of lept_parse_value() again, reporting to a handler instead of building values */
+
+#define SAX_CALL(f, args) do { if (h->f != NULL && !h->f args) return LEPT_PARSE_TERMINATED; } while(0)
+
+static int lept_sax_value(lept_context* c, const lept_handler* h, void* user);
+
+static int lept_sax_array(lept_context* c, const lept_handler* h, void* user) {
+    size_t size = 0;
+    int ret;
+    EXPECT(c, '[');
+    SAX_CALL(on_start_array, (user));
+    lept_parse_whitespace(c);
+    if (PEEK(c) == ']') {
+        c->json++;
+        SAX_CALL(on_end_array, (user, 0));
+        return LEPT_PARSE_OK;
+    }
+    for (;;) {
+        if ((ret = lept_sax_value(c, h, user)) != LEPT_PARSE_OK)
+            return ret;
+        size++;
+        lept_parse_whitespace(c);
+        if (PEEK(c) == ',') {
+            c->json++;
+            lept_parse_whitespace(c);
+        }
+        else if (PEEK(c) == ']') {
+            c->json++;
+            SAX_CALL(on_end_array, (user, size));
+            return LEPT_PARSE_OK;
+        }
+        else
+            return LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+    }
+}
+
+static int lept_sax_object(lept_context* c, const lept_handler* h, void* user) {
+    size_t size = 0, klen;
+    const char* k;
+    int ret;
+    EXPECT(c, '{');
+    SAX_CALL(on_start_object, (user));
+    lept_parse_whitespace(c);
+    if (PEEK(c) == '}') {
+        c->json++;
+        SAX_CALL(on_end_object, (user, 0));
+        return LEPT_PARSE_OK;
+    }
+    for (;;) {
+        if (PEEK(c) != '"')
+            return LEPT_PARSE_MISS_KEY;
+        if ((ret = lept_parse_string_raw(c, &k, &klen)) != LEPT_PARSE_OK)
+            return ret;
+        SAX_CALL(on_key, (user, k, klen));
+        lept_parse_whitespace(c);
+        if (PEEK(c) != ':')
+            return LEPT_PARSE_MISS_COLON;
+        c->json++;
+        lept_parse_whitespace(c);
+        if ((ret = lept_sax_value(c, h, user)) != LEPT_PARSE_OK)
+            return ret;
+        size++;
+        lept_parse_whitespace(c);
+        if (PEEK(c) == ',') {
+            c->json++;
+            lept_parse_whitespace(c);
+        }
+        else if (PEEK(c) == '}') {
+            c->json++;
+            SAX_CALL(on_end_object, (user, size));
+            return LEPT_PARSE_OK;
+        }
+        else
+            return LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+    }
+}
+
+static int lept_sax_value(lept_context* c, const lept_handler* h, void* user) {
+    lept_value v;
+    const char* s;
+    size_t len;
+    int ret;
+    switch (PEEK(c)) {
+        case '"':
+            if ((ret = lept_parse_string_raw(c, &s, &len)) != LEPT_PARSE_OK)
+                return ret;
+            SAX_CALL(on_string, (user, s, len));
+            return LEPT_PARSE_OK;
+        case '[':  return lept_sax_array(c, h, user);
+        case '{':  return lept_sax_object(c, h, user);
+        default:   /* scalars without allocation, reuse the DOM functions */
+            lept_init(&v);
+            if ((ret = lept_parse_value(c, &v)) != LEPT_PARSE_OK)
+                return ret;
+            switch (v.type) {
+                case LEPT_NULL:  SAX_CALL(on_null, (user)); break;
+                case LEPT_FALSE: SAX_CALL(on_boolean, (user, 0)); break;
+                case LEPT_TRUE:  SAX_CALL(on_boolean, (user, 1)); break;
+                default:
+                    if ((v.flags & LEPT_INT64) && h->on_int64 != NULL)
+                        SAX_CALL(on_int64, (user, v.u.i));
+                    else
+                        SAX_CALL(on_number, (user, lept_get_number(&v)));
+            }
+            return LEPT_PARSE_OK;
+    }
+}
+
+int lept_parse_sax(const char* json, size_t len, const lept_handler* h, void* user) {
+    lept_context c;
+    int ret;
+    assert(h != NULL && (json != NULL || len == 0));
+    c.json = json;
+    c.end = json + len;
+    c.stack = NULL;
+    c.size = c.top = 0;
+    c.insitu = 0;
+    c.lazy = 0;
+    c.index = NULL;
+    c.arena = NULL;
+    c.allocator = &lept_std_allocator;
+    lept_parse_whitespace(&c);
+    if ((ret = lept_sax_value(&c, h, user)) == LEPT_PARSE_OK) {
+        lept_parse_whitespace(&c);
+        if (c.json != c.end)
+            ret = LEPT_PARSE_ROOT_NOT_SINGULAR;
+    }
+    LEPT_FREE(c.allocator, c.stack);
+    return ret;
+}
+
+/* On-demand iteration: values are skipped by scanning, and parsed by the DOM functions only when read */
+
+static void lept_iter_context(lept_context* c, const char* json, const char* end) {
+    c->json = json;
+    c->end = end;
+    c->stack = NULL;
+    c->size = c->top = 0;
+    c->insitu = 0;
+    c->lazy = 0;
+    c->index = NULL;
+    c->arena = NULL;
+    c->allocator = &lept_std_allocator;
+}
+
+static int lept_iter_skip_string(lept_context* c) {
+    const char* p = c->json + 1, *end = c->end;
+    for (;;) {
+        if ((p = lept_scan_string(p, end)) == end)
+            return LEPT_PARSE_MISS_QUOTATION_MARK;
+        switch (*p++) {
+            case '\"':
+                c->json = p;
+                return LEPT_PARSE_OK;
+            case '\\':
+                if (p++ == end)
+                    return LEPT_PARSE_MISS_QUOTATION_MARK;
+                break;
+            default:
+                return LEPT_PARSE_INVALID_STRING_CHAR;
+        }
+    }
+}
+
+/* Containers are only checked for balanced brackets and strings, scalars are parsed since they are cheap */
+static int lept_iter_skip(lept_context* c) {
+    lept_value v;
+    size_t depth = 0;
+    int ret;
+    char ch;
+    switch (ch = PEEK(c)) {
+        case '"':
+            return lept_iter_skip_string(c);
+        case '[':
+        case '{':
+            do {
+                switch (PEEK(c)) {
+                    case '"':
+                        if ((ret = lept_iter_skip_string(c)) != LEPT_PARSE_OK)
+                            return ret;
+                        continue;
+                    case '[': case '{': depth++; break;
+                    case ']': case '}': depth--; break;
+                    case '\0':
+                        if (c->json == c->end)
+                            return ch == '[' ? LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET : LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+                }
+                c->json++;
+            } while (depth > 0);
+            return LEPT_PARSE_OK;
+        default:
+            lept_init(&v);
+            return lept_parse_value(c, &v);
+    }
+}
+
+int lept_iter_init(lept_iter* it, const char* json, size_t len) {
+    lept_context c;
+    assert(it != NULL && (json != NULL || len == 0));
+    lept_iter_context(&c, json, json + len);
+    lept_parse_whitespace(&c);
+    it->json = c.json;
+    it->end = c.end;
+    it->start = NULL;
+    return c.json != c.end ? LEPT_PARSE_OK : LEPT_PARSE_EXPECT_VALUE;
+}
+
+lept_type lept_iter_get_type(const lept_iter* it) {
+    assert(it != NULL && it->json != it->end);
+    switch (*it->json) {
+        case 'n':  return LEPT_NULL;
+        case 'f':  return LEPT_FALSE;
+        case 't':  return LEPT_TRUE;
+        case '"':  return LEPT_STRING;
+        case '[':  return LEPT_ARRAY;
+        case '{':  return LEPT_OBJECT;
+        default:   return LEPT_NUMBER;
+    }
+}
+
+int lept_iter_get_boolean(const lept_iter* it, int* b) {
+    lept_context c;
+    lept_value v;
+    int ret;
+    assert(b != NULL && (lept_iter_get_type(it) == LEPT_TRUE || lept_iter_get_type(it) == LEPT_FALSE));
+    lept_iter_context(&c, it->json, it->end);
+    lept_init(&v);
+    if ((ret = lept_parse_value(&c, &v)) == LEPT_PARSE_OK)
+        *b = v.type == LEPT_TRUE;
+    return ret;
+}
+
+int lept_iter_get_double(const lept_iter* it, double* n) {
+    lept_context c;
+    lept_value v;
+    int ret;
+    assert(n != NULL && lept_iter_get_type(it) == LEPT_NUMBER);
+    lept_iter_context(&c, it->json, it->end);
+    lept_init(&v);
+    if ((ret = lept_parse_number(&c, &v)) == LEPT_PARSE_OK)
+        *n = lept_get_number(&v);
+    return ret;
+}
+
+/* Parses the whole value, e.g. a string or a subtree that is needed in full */
+int lept_iter_get_value(const lept_iter* it, lept_value* v) {
+    lept_context c;
+    int ret;
+    assert(it != NULL && v != NULL);
+    lept_iter_context(&c, it->json, it->end);
+    lept_init(v);
+    ret = lept_parse_value(&c, v);
+    assert(c.top == 0);
+    LEPT_FREE(c.allocator, c.stack);
+    return ret;
+}
+
+static void lept_iter_enter(const lept_iter* it, lept_iter* cursor) {
+    lept_context c;
+    lept_iter_context(&c, it->json + 1, it->end);
+    lept_parse_whitespace(&c);
+    cursor->start = cursor->json = c.json;
+    cursor->end = c.end;
+}
+
+int lept_iter_get_object(const lept_iter* it, lept_iter* o) {
+    assert(o != NULL && lept_iter_get_type(it) == LEPT_OBJECT);
+    lept_iter_enter(it, o);
+    return LEPT_PARSE_OK;
+}
+
+int lept_iter_get_array(const lept_iter* it, lept_iter* a) {
+    assert(a != NULL && lept_iter_get_type(it) == LEPT_ARRAY);
+    lept_iter_enter(it, a);
+    return LEPT_PARSE_OK;
+}
+
+/* Reads members from o->json until the key is found or `stop` (the end of the object if NULL) is reached */
+static int lept_iter_find_member(lept_iter* o, lept_context* c, const char* stop, const char* key, size_t klen, lept_iter* value) {
+    const char* k;
+    size_t len;
+    int ret, found;
+    c->json = o->json;
+    while (c->json != stop && PEEK(c) != '}') {
+        if (PEEK(c) != '"')
+            return LEPT_PARSE_MISS_KEY;
+        if ((ret = lept_parse_string_raw(c, &k, &len)) != LEPT_PARSE_OK)
+            return ret;
+        lept_parse_whitespace(c);
+        if (PEEK(c) != ':')
+            return LEPT_PARSE_MISS_COLON;
+        c->json++;
+        lept_parse_whitespace(c);
+        value->json = c->json;
+        value->end = c->end;
+        value->start = NULL;
+        found = len == klen && memcmp(k, key, len) == 0;
+        if ((ret = lept_iter_skip(c)) != LEPT_PARSE_OK)
+            return ret;
+        lept_parse_whitespace(c);
+        if (PEEK(c) == ',') {
+            c->json++;
+            lept_parse_whitespace(c);
+            if (PEEK(c) == '}') /* a trailing comma */
+                return LEPT_PARSE_MISS_KEY;
+        }
+        else if (PEEK(c) != '}')
+            return LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+        o->json = c->json;
+        if (found)
+            return LEPT_PARSE_OK;
+    }
+    if (c->json == c->end)
+        return LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+    return LEPT_ITER_END;
+}
+
+int lept_iter_find_field(lept_iter* o, const char* key, size_t klen, lept_iter* value) {
+    lept_context c;
+    const char* from;
+    int ret;
+    assert(o != NULL && o->start != NULL && value != NULL && (key != NULL || klen == 0));
+    lept_iter_context(&c, o->json, o->end);
+    from = o->json;
+    if ((ret = lept_iter_find_member(o, &c, NULL, key, klen, value)) == LEPT_ITER_END && from != o->start) {
+        o->json = o->start;
+        ret = lept_iter_find_member(o, &c, from, key, klen, value);
+    }
+    LEPT_FREE(c.allocator, c.stack);
+    return ret;
+}
+
+int lept_iter_next_element(lept_iter* a, lept_iter* value) {
+    lept_context c;
+    int ret;
+    assert(a != NULL && a->start != NULL && value != NULL);
+    lept_iter_context(&c, a->json, a->end);
+    if (PEEK(&c) == ']')
+        return LEPT_ITER_END;
+    value->json = c.json;
+    value->end = c.end;
+    value->start = NULL;
+    if ((ret = lept_iter_skip(&c)) != LEPT_PARSE_OK)
+        return ret;
+    lept_parse_whitespace(&c);
+    if (PEEK(&c) == ',') {
+        c.json++;
+        lept_parse_whitespace(&c);
+        if (PEEK(&c) == ']') /* a trailing comma */
+            return LEPT_PARSE_INVALID_VALUE;
+    }
+    else if (PEEK(&c) != ']')
+        return LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+    a->json = c.json;
+    return LEPT_PARSE_OK;
+}
+
+/*
+ * Tape: each word is a tag in the top byte and a payload below it.
+ *   'n' 'f' 't'             literal
+ *   'd' 'l', next word      number, the double's bits or the int64
+ *   '"' offset, next word   string at strings + offset, its length
+ *   '[' '{' end, next word  container up to word `end`, element or member count; members are a key string then a value
+ *   ']' '}' start           end of the container starting at word `start`
+ * It is built by the SAX parser; while a container is open its payload links to the enclosing open container.
+ */
+
+#define LEPT_TAPE_WORD(tag, payload)    (((lept_uint64)(unsigned char)(tag) << 56) | (lept_uint64)(payload))
+#define LEPT_TAPE_TAG(w)                ((char)((w) >> 56))
+#define LEPT_TAPE_PAYLOAD(w)            ((size_t)((w) & (((lept_uint64)1 << 56) - 1)))
+
+typedef struct {
+    lept_context w, s;  /* tape words, string bytes */
+    size_t open;        /* innermost open container, plus one */
+}lept_tape_builder;
+
+static void lept_tape_push(lept_tape_builder* b, char tag, size_t payload) {
+    *(lept_uint64*)lept_context_push(&b->w, sizeof(lept_uint64)) = LEPT_TAPE_WORD(tag, payload);
+}
+
+static int lept_tape_null(void* user) { lept_tape_push((lept_tape_builder*)user, 'n', 0); return 1; }
+static int lept_tape_boolean(void* user, int b) { lept_tape_push((lept_tape_builder*)user, b ? 't' : 'f', 0); return 1; }
+
+static int lept_tape_number(void* user, double n) {
+    lept_tape_builder* b = (lept_tape_builder*)user;
+    lept_tape_push(b, 'd', 0);
+    memcpy(lept_context_push(&b->w, sizeof(lept_uint64)), &n, sizeof(double));
+    return 1;
+}
+
+static int lept_tape_int64(void* user, lept_int64 i) {
+    lept_tape_builder* b = (lept_tape_builder*)user;
+    lept_tape_push(b, 'l', 0);
+    *(lept_uint64*)lept_context_push(&b->w, sizeof(lept_uint64)) = (lept_uint64)i;
+    return 1;
+}
+
+static int lept_tape_string(void* user, const char* s, size_t len) {
+    lept_tape_builder* b = (lept_tape_builder*)user;
+    lept_tape_push(b, '"', b->s.top);
+    *(lept_uint64*)lept_context_push(&b->w, sizeof(lept_uint64)) = len;
+    memcpy(lept_context_push(&b->s, len + 1), s, len);
+    b->s.stack[b->s.top - 1] = '\0';
+    return 1;
+}
+
+static void lept_tape_start(lept_tape_builder* b, char tag) {
+    lept_tape_push(b, tag, b->open);
+    b->open = b->w.top / sizeof(lept_uint64);
+    lept_tape_push(b, tag, 0);
+}
+
+static void lept_tape_end(lept_tape_builder* b, char tag, size_t size) {
+    lept_uint64* words = (lept_uint64*)b->w.stack;
+    size_t start = b->open - 1;
+    b->open = LEPT_TAPE_PAYLOAD(words[start]);
+    words[start + 1] = size;
+    lept_tape_push(b, tag, start);
+    ((lept_uint64*)b->w.stack)[start] = LEPT_TAPE_WORD(tag == ']' ? '[' : '{', b->w.top / sizeof(lept_uint64));
+}
+
+static int lept_tape_start_array(void* user) { lept_tape_start((lept_tape_builder*)user, '['); return 1; }
+static int lept_tape_end_array(void* user, size_t size) { lept_tape_end((lept_tape_builder*)user, ']', size); return 1; }
+static int lept_tape_start_object(void* user) { lept_tape_start((lept_tape_builder*)user, '{'); return 1; }
+static int lept_tape_end_object(void* user, size_t size) { lept_tape_end((lept_tape_builder*)user, '}', size); return 1; }
+
+int lept_parse_tape(lept_tape* t, const char* json, size_t len) {
+    static const lept_handler h = {
+        lept_tape_null, lept_tape_boolean, lept_tape_number, lept_tape_int64, lept_tape_string,
+        lept_tape_start_object, lept_tape_string, lept_tape_end_object, lept_tape_start_array, lept_tape_end_array
+    };
+    lept_tape_builder b;
+    int ret;
+    assert(t != NULL);
+    memset(&b, 0, sizeof(b));
+    b.w.allocator = b.s.allocator = &lept_std_allocator;
+    t->words = NULL;
+    t->size = 0;
+    t->strings = NULL;
+    if ((ret = lept_parse_sax(json, len, &h, &b)) == LEPT_PARSE_OK) {
+        t->words = (lept_uint64*)LEPT_MALLOC(&lept_std_allocator, b.w.top + b.s.top);
+        memcpy(t->words, b.w.stack, b.w.top);
+        if (b.s.top > 0)
+            memcpy((char*)t->words + b.w.top, b.s.stack, b.s.top);
+        t->size = b.w.top / sizeof(lept_uint64);
+        t->strings = (const char*)t->words + b.w.top;
+    }
+    LEPT_FREE(&lept_std_allocator, b.w.stack);
+    LEPT_FREE(&lept_std_allocator, b.s.stack);
+    return ret;
+}
+
+void lept_free_tape(lept_tape* t) {
+    assert(t != NULL);
+    LEPT_FREE(&lept_std_allocator, t->words);
+    t->words = NULL;
+    t->size = 0;
+    t->strings = NULL;
+}
+
+lept_type lept_tape_get_type(const lept_tape* t, size_t i) {
+    assert(t != NULL && i < t->size);
+    switch (LEPT_TAPE_TAG(t->words[i])) {
+        case 'n':  return LEPT_NULL;
+        case 'f':  return LEPT_FALSE;
+        case 't':  return LEPT_TRUE;
+        case '"':  return LEPT_STRING;
+        case '[':  return LEPT_ARRAY;
+        case '{':  return LEPT_OBJECT;
+        default:   return LEPT_NUMBER;
+    }
+}
+
+size_t lept_tape_next(const lept_tape* t, size_t i) {
+    assert(t != NULL && i < t->size);
+    switch (LEPT_TAPE_TAG(t->words[i])) {
+        case 'n': case 'f': case 't': return i + 1;
+        case '[': case '{':           return LEPT_TAPE_PAYLOAD(t->words[i]);
+        default:                      return i + 2;
+    }
+}
+
+/* Converting a double out of range is undefined, so clamp it first */
+static lept_int64 lept_int64_clamp(double n) {
+    const lept_int64 max = (lept_int64)(~(lept_uint64)0 >> 1);
+    if (n >= 9223372036854775808.0)
+        return max;
+    if (n < -9223372036854775808.0)
+        return -max - 1;
+    return (lept_int64)n;
+}
+
+double lept_tape_get_number(const lept_tape* t, size_t i) {
+    double n;
+    assert(t != NULL && lept_tape_get_type(t, i) == LEPT_NUMBER);
+    if (LEPT_TAPE_TAG(t->words[i]) == 'l')
+        return (double)(lept_int64)t->words[i + 1];
+    memcpy(&n, &t->words[i + 1], sizeof(double));
+    return n;
+}
+
+int lept_tape_is_int64(const lept_tape* t, size_t i) {
+    assert(t != NULL && lept_tape_get_type(t, i) == LEPT_NUMBER);
+    return LEPT_TAPE_TAG(t->words[i]) == 'l';
+}
+
+lept_int64 lept_tape_get_int64(const lept_tape* t, size_t i) {
+    assert(t != NULL && lept_tape_get_type(t, i) == LEPT_NUMBER);
+    if (LEPT_TAPE_TAG(t->words[i]) == 'l')
+        return (lept_int64)t->words[i + 1];
+    return lept_int64_clamp(lept_tape_get_number(t, i));
+}
+
+const char* lept_tape_get_string(const lept_tape* t, size_t i) {
+    assert(t != NULL && lept_tape_get_type(t, i) == LEPT_STRING);
+    return t->strings + LEPT_TAPE_PAYLOAD(t->words[i]);
+}
+
+size_t lept_tape_get_string_length(const lept_tape* t, size_t i) {
+    assert(t != NULL && lept_tape_get_type(t, i) == LEPT_STRING);
+    return (size_t)t->words[i + 1];
+}
+
+size_t lept_tape_get_array_size(const lept_tape* t, size_t i) {
+    assert(t != NULL && lept_tape_get_type(t, i) == LEPT_ARRAY);
+    return (size_t)t->words[i + 1];
+}
+
+size_t lept_tape_get_array_element(const lept_tape* t, size_t i, size_t index) {
+    assert(index < lept_tape_get_array_size(t, i));
+    for (i += 2; index > 0; index--)
+        i = lept_tape_next(t, i);
+    return i;
+}
+
+size_t lept_tape_get_object_size(const lept_tape* t, size_t i) {
+    assert(t != NULL && lept_tape_get_type(t, i) == LEPT_OBJECT);
+    return (size_t)t->words[i + 1];
+}
+
+static size_t lept_tape_get_object_member(const lept_tape* t, size_t i, size_t index) {
+    assert(index < lept_tape_get_object_size(t, i));
+    for (i += 2; index > 0; index--)
+        i = lept_tape_next(t, i + 2);
+    return i;
+}
+
+const char* lept_tape_get_object_key(const lept_tape* t, size_t i, size_t index) {
+    return lept_tape_get_string(t, lept_tape_get_object_member(t, i, index));
+}
+
+size_t lept_tape_get_object_key_length(const lept_tape* t, size_t i, size_t index) {
+    return lept_tape_get_string_length(t, lept_tape_get_object_member(t, i, index));
+}
+
+size_t lept_tape_get_object_value(const lept_tape* t, size_t i, size_t index) {
+    return lept_tape_get_object_member(t, i, index) + 2;
+}
+
+/*
+ * Parser object: the recursion of lept_parse_value() becomes a stack of frames, so that parsing can stop between
+ * tokens and nesting depth costs heap instead of call stack.
+ */
+
+enum {
+    LEPT_STATE_VALUE,           /* a value */
+    LEPT_STATE_ARRAY_FIRST,     /* a value or ']' */
+    LEPT_STATE_OBJECT_FIRST,    /* a key or '}' */
+    LEPT_STATE_KEY,             /* a key */
+    LEPT_STATE_COLON,           /* ':' */
+    LEPT_STATE_NEXT,            /* ',' or the closing bracket */
+    LEPT_STATE_DONE             /* nothing but whitespace */
+};
+
+/* Interned keys: one null-terminated copy of each distinct key in arena blocks, found by hash */
+typedef struct {
+    char* k; size_t klen;       /* k is NULL for an empty slot */
+}lept_key;
+
+struct lept_keys {
+    lept_arena arena;           /* the copies, never moved */
+    lept_key* table;            /* power-of-two size, at most half full, linear probing */
+    size_t count, capacity;
+};
+
+lept_keys* lept_keys_create(void) {
+    return lept_keys_create_with(NULL);
+}
+
+lept_keys* lept_keys_create_with(const lept_allocator* a) {
+    lept_keys* k;
+    a = LEPT_ALLOCATOR(a);
+    k = (lept_keys*)LEPT_MALLOC(a, sizeof(lept_keys));
+    k->arena.blocks = NULL;
+    k->arena.p = k->arena.end = NULL;
+    k->arena.allocator = a;
+    k->table = NULL;
+    k->count = k->capacity = 0;
+    return k;
+}
+
+void lept_keys_destroy(lept_keys* k) {
+    const lept_allocator* a;
+    if (k == NULL)
+        return;
+    a = k->arena.allocator;
+    lept_arena_free(&k->arena);
+    LEPT_FREE(a, k->table);
+    LEPT_FREE(a, k);
+}
+
+static lept_key* lept_keys_slot(lept_key* table, size_t capacity, const char* key, size_t klen) {
+    size_t h;
+    for (h = lept_hash(key, klen) & (capacity - 1); table[h].k != NULL; h = (h + 1) & (capacity - 1))
+        if (table[h].klen == klen && memcmp(table[h].k, key, klen) == 0)
+            break;
+    return &table[h];
+}
+
+const char* lept_keys_intern(lept_keys* k, const char* key, size_t klen) {
+    lept_key* slot;
+    assert(k != NULL && (key != NULL || klen == 0));
+    if (k->count * 2 >= k->capacity) {
+        size_t i, capacity = k->capacity == 0 ? 64 : k->capacity * 2;
+        lept_key* table = (lept_key*)LEPT_MALLOC(k->arena.allocator, capacity * sizeof(lept_key));
+        memset(table, 0, capacity * sizeof(lept_key));
+        for (i = 0; i < k->capacity; i++)
+            if (k->table[i].k != NULL)
+                *lept_keys_slot(table, capacity, k->table[i].k, k->table[i].klen) = k->table[i];
+        LEPT_FREE(k->arena.allocator, k->table);
+        k->table = table;
+        k->capacity = capacity;
+    }
+    slot = lept_keys_slot(k->table, k->capacity, key, klen);
+    if (slot->k == NULL) {
+        memcpy(slot->k = (char*)lept_arena_alloc(&k->arena, klen + 1), key, klen);
+        slot->k[klen] = '\0';
+        slot->klen = klen;
+        k->count++;
+    }
+    return slot->k;
+}
+
+size_t lept_keys_count(const lept_keys* k) {
+    assert(k != NULL);
+    return k->count;
+}
+
+typedef struct {
+    lept_type type;             /* LEPT_ARRAY or LEPT_OBJECT */
+    size_t size;                /* elements or members on the stack */
+}lept_frame;
+
+struct lept_parser {
+    lept_context c;             /* elements and members of the open containers */
+    lept_frame* frames;
+    size_t depth, frames_size;
+    size_t max_depth;           /* 0 for no limit */
+    lept_keys* keys;            /* interned keys, or NULL to copy each key */
+    char* buf;                  /* input not consumed yet, an incomplete token at most */
+    size_t len, buf_size;
+    size_t scanned;             /* where lept_token_complete() resumes in that token, 0 to start over */
+    lept_value root;
+    int state, error;
+};
+
+/*
+ * Whether more input could still change how the token at c->json parses. If not, *scanned is where to resume when
+ * more input is appended, so that a token fed in many pieces is only scanned once.
+ */
+static int lept_token_complete(const lept_context* c, size_t* scanned) {
+    const char* p = c->json, *end = c->end;
+    switch (*p) {
+        case '"':
+            for (p += *scanned > 0 ? *scanned : 1;;) {
+                p = lept_scan_string(p, end);
+                if (p == end || (*p == '\\' && end - p <= 2)) {
+                    *scanned = p - c->json;
+                    return 0;
+                }
+                if (*p != '\\') {
+                    *scanned = 0;
+                    return 1;
+                }
+                p += 2;
+            }
+        case 't': return (size_t)(end - p) >= 4 || memcmp(p, "true",  end - p) != 0;
+        case 'f': return (size_t)(end - p) >= 5 || memcmp(p, "false", end - p) != 0;
+        case 'n': return (size_t)(end - p) >= 4 || memcmp(p, "null",  end - p) != 0;
+        case '-': case '0': case '1': case '2': case '3': case '4':
+        case '5': case '6': case '7': case '8': case '9':
+            for (p += *scanned; p != end && (ISDIGIT(*p) || *p == '.' || *p == 'e' || *p == 'E' || *p == '+' || *p == '-'); p++)
+                ;
+            *scanned = p != end ? 0 : p - c->json;
+            return p != end;
+        default:
+            return 1;
+    }
+}
+
+static int lept_parser_open(lept_parser* p, lept_type type) {
+    if (p->depth == p->max_depth && p->max_depth != 0)
+        return LEPT_PARSE_TOO_DEEP;
+    if (p->depth == p->frames_size) {
+        p->frames_size = p->frames_size == 0 ? 16 : p->frames_size + (p->frames_size >> 1);
+        p->frames = (lept_frame*)LEPT_REALLOC(p->c.allocator, p->frames, p->frames_size * sizeof(lept_frame));
+    }
+    p->frames[p->depth].type = type;
+    p->frames[p->depth].size = 0;
+    p->depth++;
+    p->state = type == LEPT_ARRAY ? LEPT_STATE_ARRAY_FIRST : LEPT_STATE_OBJECT_FIRST;
+    return LEPT_PARSE_OK;
+}
+
+static void lept_parser_close(lept_parser* p, lept_value* v) {
+    lept_frame* f = &p->frames[--p->depth];
+    size_t s;
+    lept_init(v);
+    v->type = f->type;
+    if (f->type == LEPT_ARRAY) {
+        v->u.a.size = f->size;
+        v->u.a.e = NULL;
+        if ((s = f->size * sizeof(lept_value)) > 0)
+            memcpy(v->u.a.e = (lept_value*)LEPT_MALLOC(p->c.allocator, s), lept_context_pop(&p->c, s), s);
+    }
+    else {
+        lept_context_pop_object(&p->c, v, f->size);
+        if (p->keys != NULL)
+            v->flags |= LEPT_SHARED_STRING;
+    }
+}
+
+/* Hands a complete value to the open container, or makes it the root */
+static void lept_parser_add(lept_parser* p, const lept_value* v) {
+    lept_context* c = &p->c;
+    if (p->depth == 0) {
+        p->root = *v;
+        p->state = LEPT_STATE_DONE;
+        return;
+    }
+    if (p->frames[p->depth - 1].type == LEPT_ARRAY) {
+        memcpy(lept_context_push(c, sizeof(lept_value)), v, sizeof(lept_value));
+        p->frames[p->depth - 1].size++;
+    }
+    else /* the member was pushed with its key */
+        ((lept_member*)(c->stack + c->top - sizeof(lept_member)))->v = *v;
+    p->state = LEPT_STATE_NEXT;
+}
+
+static int lept_parser_key(lept_parser* p) {
+    lept_member m;
+    const char* str;
+    int ret;
+    if ((ret = lept_parse_string_raw(&p->c, &str, &m.klen)) != LEPT_PARSE_OK)
+        return ret;
+    if (p->keys != NULL)
+        m.k = (char*)lept_keys_intern(p->keys, str, m.klen);
+    else {
+        memcpy(m.k = (char*)LEPT_MALLOC(p->c.allocator, m.klen + 1), str, m.klen);
+        m.k[m.klen] = '\0';
+    }
+    lept_init(&m.v);
+    memcpy(lept_context_push(&p->c, sizeof(lept_member)), &m, sizeof(lept_member));
+    p->frames[p->depth - 1].size++;
+    p->state = LEPT_STATE_COLON;
+    return LEPT_PARSE_OK;
+}
+
+/* Parses p->c.json up to p->c.end, stopping before an incomplete token unless the input is final */
+static int lept_parser_run(lept_parser* p, int final) {
+    lept_context* c = &p->c;
+    lept_value v;
+    lept_type type;
+    int ret;
+    char ch;
+    for (;;) {
+        lept_parse_whitespace(c);
+        if (!final && (c->json == c->end || !lept_token_complete(c, &p->scanned)))
+            return LEPT_PARSE_OK;
+        ch = PEEK(c);
+        switch (p->state) {
+            case LEPT_STATE_DONE: /* not ch == '\0', which a NUL in the input would pass */
+                return c->json == c->end ? LEPT_PARSE_OK : LEPT_PARSE_ROOT_NOT_SINGULAR;
+            case LEPT_STATE_NEXT:
+                type = p->frames[p->depth - 1].type;
+                if (ch == ',') {
+                    c->json++;
+                    p->state = type == LEPT_ARRAY ? LEPT_STATE_VALUE : LEPT_STATE_KEY;
+                    continue;
+                }
+                if (ch != (type == LEPT_ARRAY ? ']' : '}'))
+                    return type == LEPT_ARRAY ? LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET : LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+                if (p->frames[p->depth - 1].size > LEPT_LENGTH_MAX)
+                    return LEPT_PARSE_TOO_LONG;
+                c->json++;
+                lept_parser_close(p, &v);
+                break;
+            case LEPT_STATE_COLON:
+                if (ch != ':')
+                    return LEPT_PARSE_MISS_COLON;
+                c->json++;
+                p->state = LEPT_STATE_VALUE;
+                continue;
+            case LEPT_STATE_OBJECT_FIRST:
+                if (ch == '}') {
+                    c->json++;
+                    lept_parser_close(p, &v);
+                    break;
+                }
+                /* fall through */
+            case LEPT_STATE_KEY:
+                if (ch != '"')
+                    return LEPT_PARSE_MISS_KEY;
+                if ((ret = lept_parser_key(p)) != LEPT_PARSE_OK)
+                    return ret;
+                continue;
+            case LEPT_STATE_ARRAY_FIRST:
+                if (ch == ']') {
+                    c->json++;
+                    lept_parser_close(p, &v);
+                    break;
+                }
+                /* fall through */
+            default:
+                if (ch == '[' || ch == '{') {
+                    if ((ret = lept_parser_open(p, ch == '[' ? LEPT_ARRAY : LEPT_OBJECT)) != LEPT_PARSE_OK)
+                        return ret;
+                    c->json++;
+                    continue;
+                }
+                lept_init(&v);
+                if ((ret = lept_parse_value(c, &v)) != LEPT_PARSE_OK)
+                    return ret;
+        }
+        lept_parser_add(p, &v);
+    }
+}
+
+/* Frees everything parsed so far and gets ready for the next document */
+static void lept_parser_reset(lept_parser* p) {
+    lept_context* c = &p->c;
+    size_t i;
+    while (p->depth > 0) {
+        lept_frame* f = &p->frames[--p->depth];
+        for (i = 0; i < f->size; i++) {
+            if (f->type == LEPT_ARRAY)
+                lept_free_with((lept_value*)lept_context_pop(c, sizeof(lept_value)), c->allocator);
+            else {
+                lept_member* m = (lept_member*)lept_context_pop(c, sizeof(lept_member));
+                if (p->keys == NULL)
+                    LEPT_FREE(c->allocator, m->k);
+                lept_free_with(&m->v, c->allocator);
+            }
+        }
+    }
+    assert(c->top == 0);
+    if (p->state == LEPT_STATE_DONE)
+        lept_free_with(&p->root, c->allocator);
+    p->len = p->scanned = 0;
+    p->state = LEPT_STATE_VALUE;
+    p->error = LEPT_PARSE_OK;
+}
+
+lept_parser* lept_parser_create(void) {
+    return lept_parser_create_with(NULL);
+}
+
+lept_parser* lept_parser_create_with(const lept_allocator* a) {
+    lept_parser* p;
+    a = LEPT_ALLOCATOR(a);
+    p = (lept_parser*)LEPT_MALLOC(a, sizeof(lept_parser));
+    p->c.stack = NULL;
+    p->c.size = p->c.top = 0;
+    p->c.insitu = 0;
+    p->c.lazy = 0;
+    p->c.index = NULL;
+    p->c.arena = NULL;
+    p->c.allocator = a;
+    p->frames = NULL;
+    p->depth = p->frames_size = 0;
+    p->max_depth = 0;
+    p->keys = NULL;
+    p->buf = NULL;
+    p->len = p->buf_size = p->scanned = 0;
+    p->state = LEPT_STATE_VALUE;
+    p->error = LEPT_PARSE_OK;
+    return p;
+}
+
+void lept_parser_destroy(lept_parser* p) {
+    if (p == NULL)
+        return;
+    lept_parser_reset(p);
+    LEPT_FREE(p->c.allocator, p->c.stack);
+    LEPT_FREE(p->c.allocator, p->frames);
+    LEPT_FREE(p->c.allocator, p->buf);
+    LEPT_FREE(p->c.allocator, p);
+}
+
+void lept_parser_set_max_depth(lept_parser* p, size_t depth) {
+    assert(p != NULL);
+    p->max_depth = depth;
+}
+
+void lept_parser_set_keys(lept_parser* p, lept_keys* keys) {
+    assert(p != NULL && p->depth == 0);
+    p->keys = keys;
+}
+
+size_t lept_parser_stack_size(const lept_parser* p) {
+    assert(p != NULL);
+    return p->c.size;
+}
+
+/* Parses json[0..len) as the end of the document, hands the result to v and gets ready for the next one */
+static int lept_parser_end(lept_parser* p, lept_value* v, const char* json, size_t len) {
+    lept_context* c = &p->c;
+    int ret;
+    c->json = json;
+    c->end = json + len;
+    if ((ret = lept_parser_run(p, 1)) == LEPT_PARSE_OK) {
+        *v = p->root;
+        p->state = LEPT_STATE_VALUE; /* ownership is transferred to v */
+    }
+    lept_parser_reset(p);
+    return ret;
+}
+
+int lept_parser_parse(lept_parser* p, lept_value* v, const char* json, size_t len) {
+    assert(p != NULL && v != NULL && (json != NULL || len == 0));
+    assert(p->state == LEPT_STATE_VALUE && p->len == 0); /* not in the middle of a fed document */
+    lept_init(v);
+    return lept_parser_end(p, v, json, len);
+}
+
+int lept_parser_feed(lept_parser* p, const char* json, size_t len) {
+    lept_context* c = &p->c;
+    assert(p != NULL && (json != NULL || len == 0));
+    if (p->error != LEPT_PARSE_OK || len == 0)
+        return p->error;
+    if (p->len > 0) { /* complete the pending token: append and parse from the buffer */
+        if (p->len + len > p->buf_size) {
+            p->buf_size = p->len + len + ((p->len + len) >> 1);
+            p->buf = (char*)LEPT_REALLOC(c->allocator, p->buf, p->buf_size);
+        }
+        memcpy(p->buf + p->len, json, len);
+        json = p->buf;
+        len += p->len;
+    }
+    c->json = json;
+    c->end = json + len;
+    if ((p->error = lept_parser_run(p, 0)) != LEPT_PARSE_OK) {
+        int ret = p->error;
+        lept_parser_reset(p);
+        return p->error = ret;
+    }
+    /* keep the rest, which is one incomplete token at most, and already in place if no token was complete */
+    if ((p->len = c->end - c->json) > 0 && c->json != p->buf) {
+        if (p->len > p->buf_size) {
+            p->buf_size = p->len + (p->len >> 1);
+            p->buf = (char*)LEPT_REALLOC(c->allocator, p->buf, p->buf_size);
+        }
+        memmove(p->buf, c->json, p->len);
+    }
+    return LEPT_PARSE_OK;
+}
+
+int lept_parser_finish(lept_parser* p, lept_value* v) {
+    int ret;
+    assert(p != NULL && v != NULL);
+    lept_init(v);
+    if ((ret = p->error) == LEPT_PARSE_OK)
+        return lept_parser_end(p, v, p->buf, p->len);
+    lept_parser_reset(p);
+    return ret;
+}
+
+#if 0
+// Unoptimized
+static void lept_stringify_string(lept_context* c, const char* s, size_t len) {
+    size_t i;
+    assert(s != NULL);
+    PUTC(c, '"');
+    for (i = 0; i < len; i++) {
+        unsigned char ch = (unsigned char)s[i];
+        switch (ch) {
+            case '\"': PUTS(c, "\\\"", 2); break;
+            case '\\': PUTS(c, "\\\\", 2); break;
+            case '\b': PUTS(c, "\\b",  2); break;
             case '\f': PUTS(c, "\\f",  2); break;
             case '\n': PUTS(c, "\\n",  2); break;
             case '\r': PUTS(c, "\\r",  2); break;
@@ -407,14 +3027,35 @@ static void lept_stringify_string(lept_context* c, const char* s, size_t len) {
 }
 #endif
 
+static void lept_stringify_int64(lept_context* c, lept_int64 i) {
+    char buffer[20], *p = buffer + sizeof(buffer); /* "-9223372036854775808" */
+    lept_uint64 u = i < 0 ? (lept_uint64)0 - (lept_uint64)i : (lept_uint64)i;
+    do {
+        *--p = (char)('0' + u % 10);
+        u /= 10;
+    } while (u != 0);
+    if (i < 0)
+        *--p = '-';
+    PUTS(c, p, buffer + sizeof(buffer) - p);
+}
+
 static void lept_stringify_value(lept_context* c, const lept_value* v) {
     size_t i;
     switch (v->type) {
         case LEPT_NULL:   PUTS(c, "null",  4); break;
         case LEPT_FALSE:  PUTS(c, "false", 5); break;
         case LEPT_TRUE:   PUTS(c, "true",  4); break;
-        case LEPT_NUMBER: c->top -= 32 - sprintf(lept_context_push(c, 32), "%.17g", v->u.n); break;
-        case LEPT_STRING: lept_stringify_string(c, v->u.s.s, v->u.s.len); break;
+        case LEPT_NUMBER:
+            if (v->flags & LEPT_LAZY_NUMBER)
+                PUTS(c, v->u.s.s, v->u.s.len);
+            else if (v->flags & LEPT_INT64)
+                lept_stringify_int64(c, v->u.i);
+            else
+                c->top -= 32 - sprintf(lept_context_push(c, 32), "%.17g", v->u.n);
+            break;
+        case LEPT_STRING:
+            lept_stringify_string(c, v->flags & LEPT_LAZY_STRING ? v->u.s.s : lept_get_string(v), lept_get_string_length(v));
+            break;
         case LEPT_ARRAY:
             PUTC(c, '[');
             for (i = 0; i < v->u.a.size; i++) {
@@ -440,9 +3081,14 @@ static void lept_stringify_value(lept_context* c, const lept_value* v) {
 }
 
 char* lept_stringify(const lept_value* v, size_t* length) {
+    return lept_stringify_with(v, length, NULL);
+}
+
+char* lept_stringify_with(const lept_value* v, size_t* length, const lept_allocator* a) {
     lept_context c;
     assert(v != NULL);
-    c.stack = (char*)malloc(c.size = LEPT_PARSE_STRINGIFY_INIT_SIZE);
+    c.allocator = LEPT_ALLOCATOR(a);
+    c.stack = (char*)LEPT_MALLOC(c.allocator, c.size = LEPT_PARSE_STRINGIFY_INIT_SIZE);
     c.top = 0;
     lept_stringify_value(&c, v);
     if (length)
@@ -452,27 +3098,88 @@ char* lept_stringify(const lept_value* v, size_t* length) {
 }
 
 void lept_free(lept_value* v) {
-    size_t i;
-    assert(v != NULL);
+    lept_free_with(v, NULL);
+}
+
+/* Frees what v owns itself, once its elements or members are freed */
+static void lept_free_shallow(lept_value* v, const lept_allocator* a) {
     switch (v->type) {
         case LEPT_STRING:
-            free(v->u.s.s);
+            if (!(v->flags & (LEPT_SHARED_STRING | LEPT_ARENA | LEPT_INLINE_STRING | LEPT_LAZY_STRING)))
+                LEPT_FREE(a, v->u.s.s);
             break;
         case LEPT_ARRAY:
-            for (i = 0; i < v->u.a.size; i++)
-                lept_free(&v->u.a.e[i]);
-            free(v->u.a.e);
+            if (!(v->flags & LEPT_ARENA))
+                LEPT_FREE(a, v->u.a.e);
             break;
         case LEPT_OBJECT:
-            for (i = 0; i < v->u.o.size; i++) {
-                free(v->u.o.m[i].k);
-                lept_free(&v->u.o.m[i].v);
-            }
-            free(v->u.o.m);
+            if (!(v->flags & LEPT_ARENA))
+                LEPT_FREE(a, v->u.o.m);
             break;
         default: break;
     }
     v->type = LEPT_NULL;
+    v->flags = 0;
+}
+
+#define ISCONTAINER(v)      ((v)->type == LEPT_ARRAY || (v)->type == LEPT_OBJECT)
+
+/* Frees the elements or members of v from i on up to the first container, and returns its index */
+static size_t lept_free_children(lept_value* v, size_t i, const lept_allocator* a) {
+    if (v->type == LEPT_ARRAY) {
+        for (; i < v->u.a.size; i++) {
+            if (ISCONTAINER(&v->u.a.e[i]))
+                break;
+            lept_free_shallow(&v->u.a.e[i], a);
+        }
+        return i;
+    }
+    for (; i < v->u.o.size; i++) {
+        lept_member* m = &v->u.o.m[i];
+        if (!(v->flags & (LEPT_SHARED_STRING | LEPT_ARENA)))
+            LEPT_FREE(a, m->k);
+        if (ISCONTAINER(&m->v))
+            break;
+        lept_free_shallow(&m->v, a);
+    }
+    return i;
+}
+
+typedef struct {
+    lept_value* v;
+    size_t i;                   /* where to resume in v */
+}lept_free_frame;
+
+/* Iterative, as the parser object builds values nested deeper than the call stack allows */
+void lept_free_with(lept_value* v, const lept_allocator* a) {
+    lept_context c;             /* the containers being freed, outermost first */
+    lept_free_frame* f;
+    size_t i = 0, size;
+    assert(v != NULL);
+    a = LEPT_ALLOCATOR(a);
+    c.stack = NULL;
+    c.size = c.top = 0;
+    c.allocator = a;
+    for (;;) {
+        if (ISCONTAINER(v)) {
+            size = v->type == LEPT_ARRAY ? v->u.a.size : v->u.o.size;
+            if ((i = lept_free_children(v, i, a)) < size) { /* descend, coming back after it */
+                f = (lept_free_frame*)lept_context_push(&c, sizeof(lept_free_frame));
+                f->v = v;
+                f->i = i + 1;
+                v = v->type == LEPT_ARRAY ? &v->u.a.e[i] : &v->u.o.m[i].v;
+                i = 0;
+                continue;
+            }
+        }
+        lept_free_shallow(v, a);
+        if (c.top == 0)
+            break;
+        f = (lept_free_frame*)lept_context_pop(&c, sizeof(lept_free_frame));
+        v = f->v;
+        i = f->i;
+    }
+    LEPT_FREE(a, c.stack);
 }
 
 lept_type lept_get_type(const lept_value* v) {
@@ -492,7 +3199,12 @@ void lept_set_boolean(lept_value* v, int b) {
 
 double lept_get_number(const lept_value* v) {
     assert(v != NULL && v->type == LEPT_NUMBER);
-    return v->u.n;
+    if (v->flags & LEPT_LAZY_NUMBER) {
+        lept_number_materialize((lept_value*)v);
+        if (v->flags & LEPT_LAZY_NUMBER)
+            return *v->u.s.s == '-' ? -HUGE_VAL : HUGE_VAL;
+    }
+    return v->flags & LEPT_INT64 ? (double)v->u.i : v->u.n;
 }
 
 void lept_set_number(lept_value* v, double n) {
@@ -501,23 +3213,62 @@ void lept_set_number(lept_value* v, double n) {
     v->type = LEPT_NUMBER;
 }
 
+int lept_is_int64(const lept_value* v) {
+    assert(v != NULL && v->type == LEPT_NUMBER);
+    if (v->flags & LEPT_LAZY_NUMBER)
+        lept_number_materialize((lept_value*)v);
+    return (v->flags & LEPT_INT64) != 0;
+}
+
+lept_int64 lept_get_int64(const lept_value* v) {
+    assert(v != NULL && v->type == LEPT_NUMBER);
+    if (v->flags & LEPT_LAZY_NUMBER)
+        return lept_is_int64(v) ? v->u.i : lept_int64_clamp(lept_get_number(v));
+    return v->flags & LEPT_INT64 ? v->u.i : lept_int64_clamp(v->u.n);
+}
+
+void lept_set_int64(lept_value* v, lept_int64 i) {
+    lept_free(v);
+    v->u.i = i;
+    v->type = LEPT_NUMBER;
+    v->flags = LEPT_INT64;
+}
+
 const char* lept_get_string(const lept_value* v) {
     assert(v != NULL && v->type == LEPT_STRING);
-    return v->u.s.s;
+    if (v->flags & LEPT_LAZY_STRING) { /* a copy of its own, with a terminator */
+        lept_value s;
+        lept_init(&s);
+        lept_set_string(&s, v->u.s.s, v->u.s.len);
+        *(lept_value*)v = s;
+    }
+    return v->flags & LEPT_INLINE_STRING ? v->u.c : v->u.s.s;
 }
 
 size_t lept_get_string_length(const lept_value* v) {
     assert(v != NULL && v->type == LEPT_STRING);
-    return v->u.s.len;
+    return v->flags & LEPT_INLINE_STRING ? v->flags >> LEPT_INLINE_SHIFT : v->u.s.len;
 }
 
 void lept_set_string(lept_value* v, const char* s, size_t len) {
-    assert(v != NULL && (s != NULL || len == 0));
-    lept_free(v);
-    v->u.s.s = (char*)malloc(len + 1);
-    memcpy(v->u.s.s, s, len);
-    v->u.s.s[len] = '\0';
-    v->u.s.len = len;
+    lept_set_string_with(v, s, len, NULL);
+}
+
+void lept_set_string_with(lept_value* v, const char* s, size_t len, const lept_allocator* a) {
+    assert(v != NULL && (s != NULL || len == 0) && len <= LEPT_LENGTH_MAX);
+    a = LEPT_ALLOCATOR(a);
+    lept_free_with(v, a);
+    if (len <= LEPT_INLINE_MAX) {
+        memcpy(v->u.c, s, len);
+        v->u.c[len] = '\0';
+        v->flags = LEPT_INLINE_STRING | (unsigned)len << LEPT_INLINE_SHIFT;
+    }
+    else {
+        v->u.s.s = (char*)LEPT_MALLOC(a, len + 1);
+        memcpy(v->u.s.s, s, len);
+        v->u.s.s[len] = '\0';
+        v->u.s.len = len;
+    }
     v->type = LEPT_STRING;
 }
 
@@ -549,8 +3300,99 @@ size_t lept_get_object_key_length(const lept_value* v, size_t index) {
     return v->u.o.m[index].klen;
 }
 
+lept_value* lept_find_object_value(const lept_value* v, const char* key, size_t klen) {
+    size_t i, cap, h, *t;
+    assert(v != NULL && v->type == LEPT_OBJECT && (key != NULL || klen == 0));
+    if (v->flags & LEPT_HASHED) {
+        cap = lept_hash_capacity(v->u.o.size);
+        t = (size_t*)(v->u.o.m + v->u.o.size);
+        for (h = lept_hash(key, klen) & (cap - 1); t[h] != 0; h = (h + 1) & (cap - 1)) {
+            lept_member* m = &v->u.o.m[t[h] - 1];
+            if (m->klen == klen && (m->k == key || memcmp(m->k, key, klen) == 0))
+                return &m->v;
+        }
+        return NULL;
+    }
+    for (i = 0; i < v->u.o.size; i++)
+        if (v->u.o.m[i].klen == klen && (v->u.o.m[i].k == key || memcmp(v->u.o.m[i].k, key, klen) == 0))
+            return &v->u.o.m[i].v;
+    return NULL;
+}
+
 lept_value* lept_get_object_value(const lept_value* v, size_t index) {
     assert(v != NULL && v->type == LEPT_OBJECT);
     assert(index < v->u.o.size);
     return &v->u.o.m[index].v;
 }
+
+/* JSON Pointer: the reference tokens are unescaped once, and those that are array indices converted once */
+
+typedef struct {
+    const char* k; size_t klen; /* unescaped reference token */
+    size_t index;               /* the token as an array index, or (size_t)-1 */
+}lept_pointer_token;
+
+struct lept_pointer {
+    lept_pointer_token* tokens; /* followed by the tokens, then their characters, in the same allocation */
+    size_t n;
+};
+
+lept_pointer* lept_pointer_compile(const char* path) {
+    lept_pointer* p;
+    lept_pointer_token* t;
+    const char* s;
+    char* dst;
+    size_t n = 0, len;
+    assert(path != NULL);
+    if (*path != '/' && *path != '\0')
+        return NULL;
+    for (s = path; *s != '\0'; s++)
+        if (*s == '/')
+            n++;
+    len = s - path;
+    p = (lept_pointer*)LEPT_MALLOC(&lept_std_allocator, sizeof(lept_pointer) + n * sizeof(lept_pointer_token) + len);
+    p->tokens = (lept_pointer_token*)(p + 1);
+    p->n = n;
+    dst = (char*)(p->tokens + n);
+    for (s = path, t = p->tokens; *s != '\0'; t++) {
+        t->k = dst;
+        for (s++; *s != '/' && *s != '\0'; s++) {
+            if (*s != '~')
+                *dst++ = *s;
+            else if (s[1] == '0' || s[1] == '1')
+                *dst++ = *++s == '0' ? '~' : '/';
+            else {
+                LEPT_FREE(&lept_std_allocator, p);
+                return NULL;
+            }
+        }
+        t->klen = dst - t->k;
+        t->index = t->klen > 0 && (t->klen == 1 || t->k[0] != '0') ? 0 : (size_t)-1;
+        for (len = 0; len < t->klen && t->index != (size_t)-1; len++) {
+            if (!ISDIGIT(t->k[len]) || t->index > ((size_t)-1 - 9) / 10)
+                t->index = (size_t)-1;
+            else
+                t->index = t->index * 10 + (t->k[len] - '0');
+        }
+    }
+    return p;
+}
+
+void lept_pointer_free(lept_pointer* p) {
+    LEPT_FREE(&lept_std_allocator, p);
+}
+
+lept_value* lept_pointer_get(const lept_value* v, const lept_pointer* p) {
+    size_t i;
+    assert(v != NULL && p != NULL);
+    for (i = 0; i < p->n && v != NULL; i++) {
+        const lept_pointer_token* t = &p->tokens[i];
+        if (v->type == LEPT_OBJECT)
+            v = lept_find_object_value(v, t->k, t->klen);
+        else if (v->type == LEPT_ARRAY && t->index < v->u.a.size)
+            v = &v->u.a.e[t->index];
+        else
+            v = NULL;
+    }
+    return (lept_value*)v;
+}
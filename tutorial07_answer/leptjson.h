@@ -3,21 +3,57 @@
 
 #include <stddef.h> /* size_t */
 
+#if defined(_MSC_VER)
+typedef __int64 lept_int64;
+typedef unsigned __int64 lept_uint64;
+#elif defined(__GNUC__)
+__extension__ typedef long long lept_int64; /* C89 has no long long, __extension__ keeps -pedantic quiet */
+__extension__ typedef unsigned long long lept_uint64;
+#else
+typedef long long lept_int64;
+typedef unsigned long long lept_uint64;
+#endif
+
 typedef enum { LEPT_NULL, LEPT_FALSE, LEPT_TRUE, LEPT_NUMBER, LEPT_STRING, LEPT_ARRAY, LEPT_OBJECT } lept_type;
 
 typedef struct lept_value lept_value;
 typedef struct lept_member lept_member;
 
+/*
+ * Defining LEPT_COMPACT_VALUE, for the library and its users alike, shrinks lept_value to 16 bytes and lept_member
+ * to 32 on 64-bit targets: counts and lengths become 32-bit, the union is packed to 4-byte alignment and the type
+ * shares a word with the flags. Strings, arrays and objects are then limited to 2^32 - 1 bytes or elements, and
+ * parsing a longer one fails with LEPT_PARSE_TOO_LONG rather than truncating it.
+ */
+#ifdef LEPT_COMPACT_VALUE
+typedef unsigned lept_length;
+#pragma pack(push, 4)
+#else
+typedef size_t lept_length;
+#endif
+
 struct lept_value {
     union {
-        struct { lept_member* m; size_t size; }o;   /* object: members, member count */
-        struct { lept_value* e; size_t size; }a;    /* array:  elements, element count */
-        struct { char* s; size_t len; }s;           /* string: null-terminated string, string length */
-        double n;                                   /* number */
+        struct { lept_member* m; lept_length size; }o;  /* object: members, member count */
+        struct { lept_value* e; lept_length size; }a;   /* array:  elements, element count */
+        struct { char* s; lept_length len; }s;          /* string: null-terminated string, string length */
+        char c[sizeof(char*) + sizeof(lept_length)];    /* string: short null-terminated string stored inline */
+        double n;                                       /* number */
+        lept_int64 i;                                   /* number: integer without fraction or exponent */
     }u;
+#ifdef LEPT_COMPACT_VALUE
+    unsigned type : 8;                                  /* lept_type */
+    unsigned flags : 24;                                /* internal representation flags */
+#else
     lept_type type;
+    unsigned flags;                                     /* internal representation flags */
+#endif
 };
 
+#ifdef LEPT_COMPACT_VALUE
+#pragma pack(pop)
+#endif
+
 struct lept_member {
     char* k; size_t klen;   /* member key string, key string length */
     lept_value v;           /* member value */
@@ -37,15 +73,190 @@ enum {
     LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET,
     LEPT_PARSE_MISS_KEY,
     LEPT_PARSE_MISS_COLON,
-    LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET
+    LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET,
+    LEPT_PARSE_TERMINATED,
+    LEPT_ITER_END,
+    LEPT_PARSE_TOO_DEEP,
+    LEPT_PARSE_IO_ERROR,
+    LEPT_PARSE_TOO_LONG
 };
 
-#define lept_init(v) do { (v)->type = LEPT_NULL; } while(0)
+/* lept_parse_flags() and lept_parse_file() flags */
+enum {
+    LEPT_PARSE_DEFAULT_FLAG = 0,
+    LEPT_PARSE_PARALLEL_FLAG = 1,       /* parse with lept_parse_parallel() on one thread per CPU */
+    LEPT_PARSE_LAZY_NUMBER_FLAG = 2,    /* convert numbers when first read, not for lept_parse_file() */
+    LEPT_PARSE_LAZY_STRING_FLAG = 4,    /* copy strings without escapes when first read, not for lept_parse_file() */
+    LEPT_PARSE_INDEX_FLAG = 8           /* index the structure of the input in a first pass, see lept_parse_flags() */
+};
+
+/*
+ * Memory for the _with() functions, NULL selects malloc(), realloc() and free(). An allocator is not assumed to be
+ * thread-safe: lept_parse_flags_with() then ignores LEPT_PARSE_PARALLEL_FLAG, and the functions that parse on several
+ * threads, lept_parse_ndjson(), lept_parse_parallel() and lept_parse_batch() without a document, use malloc() only.
+ * It also ignores LEPT_PARSE_LAZY_STRING_FLAG, as lept_get_string() copies lazy strings with malloc().
+ */
+typedef struct {
+    void* (*alloc)(void* user, size_t size);
+    void* (*realloc)(void* user, void* p, size_t size);
+    void (*free)(void* user, void* p);
+    void* user;
+}lept_allocator;
+
+#define lept_init(v) do { (v)->type = LEPT_NULL; (v)->flags = 0; } while(0)
 
 int lept_parse(lept_value* v, const char* json);
+/* json[0..len) needs no null terminator */
+int lept_parse_n(lept_value* v, const char* json, size_t len);
+/* v is allocated with a, free it with lept_free_with() */
+int lept_parse_with(lept_value* v, const char* json, size_t len, const lept_allocator* a);
+/* Decodes strings and keys in place: json[0..len) must be writable and outlive v */
+int lept_parse_insitu(lept_value* v, char* json, size_t len);
+int lept_parse_insitu_with(lept_value* v, char* json, size_t len, const lept_allocator* a);
+/* Parses into blocks owned by the document, the root is valid until the next parse and freed only with the document */
+typedef struct lept_document lept_document;
+lept_document* lept_document_create(void);
+lept_document* lept_document_create_with(const lept_allocator* a);
+void lept_document_destroy(lept_document* d);
+int lept_document_parse(lept_document* d, const char* json, size_t len);
+const lept_value* lept_document_root(const lept_document* d);
+/*
+ * Newline-delimited JSON: v becomes an array of the values of all non-blank lines, in input order.
+ * Parts of the input are parsed on up to `threads` threads, 0 for one per CPU.
+ * On error v is null and *error_line, if not NULL, is the 0-based number of the first line that failed, or the number
+ * of lines with LEPT_PARSE_TOO_LONG for more values than an array holds.
+ */
+int lept_parse_ndjson(lept_value* v, const char* json, size_t len, unsigned threads, size_t* error_line);
+/* Same as lept_parse_n(), but the elements of a top-level array are parsed on up to `threads` threads */
+int lept_parse_parallel(lept_value* v, const char* json, size_t len, unsigned threads);
+/*
+ * With LEPT_PARSE_LAZY_NUMBER_FLAG numbers are only validated and keep pointing into json[0..len), which must outlive
+ * v. The first lept_get_number(), lept_is_int64() or lept_get_int64() converts a number and caches it in place, so
+ * such values must not be read from several threads at once. Numbers not read yet are stringified exactly as in the
+ * input; one too big for a double is never cached and reads as +-HUGE_VAL.
+ * LEPT_PARSE_LAZY_STRING_FLAG does the same for long strings without escapes: they are checked but not copied until
+ * the first lept_get_string(), while lept_get_string_length() and lept_stringify() read them from the input.
+ * LEPT_PARSE_INDEX_FLAG parses in two stages: a first pass finds the strings and the structural characters of the
+ * input, a chunk at a time, and the parser jumps over the strings and whitespace it has indexed instead of scanning
+ * them again. It gives the same results; the first pass pays off on deeply indented input, while strings are scanned
+ * about as fast without it.
+ */
+int lept_parse_flags(lept_value* v, const char* json, size_t len, unsigned flags);
+int lept_parse_flags_with(lept_value* v, const char* json, size_t len, unsigned flags, const lept_allocator* a);
+/* Parses a file from a read-only memory mapping where possible; LEPT_PARSE_IO_ERROR if it cannot be read */
+int lept_parse_file(lept_value* v, const char* path, unsigned flags);
+int lept_parse_file_with(lept_value* v, const char* path, unsigned flags, const lept_allocator* a);
+/*
+ * Parses docs[i][0..lens[i]) into results[i] for every i < n, sharing one stack per thread, on up to `threads` threads.
+ * With a document d the results live in its arena until its next parse, otherwise they are freed with lept_free().
+ * A document created with an allocator of its own is parsed on the calling thread only, as the allocator need not be
+ * thread-safe. errors, if not NULL, receives each error code. Returns the number of documents that failed.
+ */
+size_t lept_parse_batch(lept_document* d, const char* const* docs, const size_t* lens, size_t n,
+    lept_value* results, int* errors, unsigned threads);
+/*
+ * Interned keys: a single copy of each distinct key, so equal keys have equal pointers. Values whose keys were
+ * interned must be freed before the table. A table is not thread-safe, use one per thread.
+ */
+typedef struct lept_keys lept_keys;
+lept_keys* lept_keys_create(void);
+lept_keys* lept_keys_create_with(const lept_allocator* a);
+void lept_keys_destroy(lept_keys* k);
+const char* lept_keys_intern(lept_keys* k, const char* key, size_t klen);
+size_t lept_keys_count(const lept_keys* k);
+/*
+ * A parser keeps its stack between documents, which are either parsed whole or fed in chunks of any size.
+ * It does not recurse; nesting beyond the maximum depth (0 for no limit, the default) fails with LEPT_PARSE_TOO_DEEP.
+ * lept_parser_stack_size() is the high-water mark of that stack in bytes.
+ */
+typedef struct lept_parser lept_parser;
+lept_parser* lept_parser_create(void);
+lept_parser* lept_parser_create_with(const lept_allocator* a);
+void lept_parser_destroy(lept_parser* p);
+void lept_parser_set_max_depth(lept_parser* p, size_t depth);
+/* Keys of objects parsed from now on point into keys, NULL to copy them again; only between documents */
+void lept_parser_set_keys(lept_parser* p, lept_keys* keys);
+int lept_parser_parse(lept_parser* p, lept_value* v, const char* json, size_t len);
+size_t lept_parser_stack_size(const lept_parser* p);
+int lept_parser_feed(lept_parser* p, const char* json, size_t len);
+int lept_parser_finish(lept_parser* p, lept_value* v);
+
+/*
+ * Event-based parsing without building values. A callback returns 0 to stop parsing with LEPT_PARSE_TERMINATED;
+ * NULL callbacks are skipped, and integers go to on_number() if on_int64() is NULL.
+ * Strings and keys are only valid during the call.
+ */
+typedef struct {
+    int (*on_null)(void* user);
+    int (*on_boolean)(void* user, int b);
+    int (*on_number)(void* user, double n);
+    int (*on_int64)(void* user, lept_int64 i);
+    int (*on_string)(void* user, const char* s, size_t len);
+    int (*on_start_object)(void* user);
+    int (*on_key)(void* user, const char* k, size_t klen);
+    int (*on_end_object)(void* user, size_t size);
+    int (*on_start_array)(void* user);
+    int (*on_end_array)(void* user, size_t size);
+}lept_handler;
+
+int lept_parse_sax(const char* json, size_t len, const lept_handler* h, void* user);
+
+/*
+ * On-demand access: a lept_iter points into json[0..len), values are parsed only when asked for and everything
+ * else is skipped, checking little more than brackets and quotes. Object and array cursors move forward only;
+ * lept_iter_find_field() wraps around once, so reading fields in document order costs a single pass.
+ */
+typedef struct {
+    const char* json, *end; /* value or next member/element, end of input */
+    const char* start;      /* first member/element of a cursor's container */
+}lept_iter;
+
+int lept_iter_init(lept_iter* it, const char* json, size_t len);
+lept_type lept_iter_get_type(const lept_iter* it);
+int lept_iter_get_boolean(const lept_iter* it, int* b);
+int lept_iter_get_double(const lept_iter* it, double* n);
+int lept_iter_get_value(const lept_iter* it, lept_value* v);
+int lept_iter_get_object(const lept_iter* it, lept_iter* o);
+int lept_iter_find_field(lept_iter* o, const char* key, size_t klen, lept_iter* value);
+int lept_iter_get_array(const lept_iter* it, lept_iter* a);
+int lept_iter_next_element(lept_iter* a, lept_iter* value);
+
+/*
+ * Flat document: the whole parse result in one allocation, a tape of 64-bit words followed by the strings.
+ * Values are addressed by their word index, the root is 0, and lept_tape_next() steps over a value in O(1).
+ */
+typedef struct {
+    lept_uint64* words; size_t size;    /* tape, word count */
+    const char* strings;                /* null-terminated strings, stored after the tape */
+}lept_tape;
+
+int lept_parse_tape(lept_tape* t, const char* json, size_t len);
+void lept_free_tape(lept_tape* t);
+
+lept_type lept_tape_get_type(const lept_tape* t, size_t i);
+size_t lept_tape_next(const lept_tape* t, size_t i);
+double lept_tape_get_number(const lept_tape* t, size_t i);
+int lept_tape_is_int64(const lept_tape* t, size_t i);
+lept_int64 lept_tape_get_int64(const lept_tape* t, size_t i); /* as lept_get_int64() */
+const char* lept_tape_get_string(const lept_tape* t, size_t i);
+size_t lept_tape_get_string_length(const lept_tape* t, size_t i);
+size_t lept_tape_get_array_size(const lept_tape* t, size_t i);
+/*
+ * Elements and members are found by stepping over the ones before them, in O(index). To visit them all in O(n),
+ * start at element i + 2 and step with lept_tape_next(); a member has its key at word m, its value at m + 2, and the
+ * next member at lept_tape_next(t, m + 2).
+ */
+size_t lept_tape_get_array_element(const lept_tape* t, size_t i, size_t index);
+size_t lept_tape_get_object_size(const lept_tape* t, size_t i);
+const char* lept_tape_get_object_key(const lept_tape* t, size_t i, size_t index);
+size_t lept_tape_get_object_key_length(const lept_tape* t, size_t i, size_t index);
+size_t lept_tape_get_object_value(const lept_tape* t, size_t i, size_t index);
+
 char* lept_stringify(const lept_value* v, size_t* length);
+char* lept_stringify_with(const lept_value* v, size_t* length, const lept_allocator* a);
 
 void lept_free(lept_value* v);
+void lept_free_with(lept_value* v, const lept_allocator* a);
 
 lept_type lept_get_type(const lept_value* v);
 
@@ -57,9 +268,16 @@ void lept_set_boolean(lept_value* v, int b);
 double lept_get_number(const lept_value* v);
 void lept_set_number(lept_value* v, double n);
 
+int lept_is_int64(const lept_value* v);
+/* Other numbers are truncated toward zero, and clamped to the range of lept_int64 */
+lept_int64 lept_get_int64(const lept_value* v);
+void lept_set_int64(lept_value* v, lept_int64 i);
+
+/* Short strings are stored inside v itself, the pointer only stays valid while v is not moved */
 const char* lept_get_string(const lept_value* v);
 size_t lept_get_string_length(const lept_value* v);
 void lept_set_string(lept_value* v, const char* s, size_t len);
+void lept_set_string_with(lept_value* v, const char* s, size_t len, const lept_allocator* a);
 
 size_t lept_get_array_size(const lept_value* v);
 lept_value* lept_get_array_element(const lept_value* v, size_t index);
@@ -68,5 +286,19 @@ size_t lept_get_object_size(const lept_value* v);
 const char* lept_get_object_key(const lept_value* v, size_t index);
 size_t lept_get_object_key_length(const lept_value* v, size_t index);
 lept_value* lept_get_object_value(const lept_value* v, size_t index);
+/*
+ * The value of the first member with the key, or NULL; parsed objects with many members are looked up by hash.
+ * An interned key matches on its pointer before its bytes are compared.
+ */
+lept_value* lept_find_object_value(const lept_value* v, const char* key, size_t klen);
+
+/*
+ * JSON Pointer (RFC 6901): a path such as "/a/b/0" is compiled once, then resolved against any number of values.
+ * lept_pointer_compile() returns NULL for an invalid path, lept_pointer_get() NULL where nothing is referenced.
+ */
+typedef struct lept_pointer lept_pointer;
+lept_pointer* lept_pointer_compile(const char* path);
+void lept_pointer_free(lept_pointer* p);
+lept_value* lept_pointer_get(const lept_value* v, const lept_pointer* p);
 
 #endif /* LEPTJSON_H__ */
@@ -2,6 +2,7 @@
 #define _CRTDBG_MAP_ALLOC
 #include <crtdbg.h>
 #endif
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -102,6 +103,83 @@ static void test_parse_number() {
     TEST_NUMBER(-2.2250738585072014e-308, "-2.2250738585072014e-308");
     TEST_NUMBER( 1.7976931348623157e+308, "1.7976931348623157e+308");  /* Max double */
     TEST_NUMBER(-1.7976931348623157e+308, "-1.7976931348623157e+308");
+
+    /* beyond the exact fast path */
+    TEST_NUMBER(1e23, "1e23");
+    TEST_NUMBER(1e-23, "1e-23");
+    TEST_NUMBER(0.1, "0.1");
+    TEST_NUMBER(0.001, "0.00100");
+    TEST_NUMBER(3.141592653589793, "3.141592653589793238462643383279");
+    TEST_NUMBER(123456789012345678901234567890.0, "123456789012345678901234567890");
+    TEST_NUMBER(9007199254740992.0, "9007199254740993"); /* halfway, round to even */
+    TEST_NUMBER(9007199254740994.0, "9007199254740993.0000000000000000000000001");
+    TEST_NUMBER(9007199254740996.0, "9007199254740995");
+    TEST_NUMBER(2.2250738585072011e-308, "2.2250738585072011e-308");
+    TEST_NUMBER(4.9406564584124654e-324, "2.4703282292062328e-324"); /* just above half of the minimum denormal */
+    TEST_NUMBER(0.0, "2.4703282292062327e-324");
+    TEST_NUMBER(1.7976931348623157e+308, "1.7976931348623158e+308");
+    TEST_NUMBER(1.0, "1.000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000");
+
+    /* up to 19 digits, as printed with %.17g */
+    TEST_NUMBER(93.94648016852722, "93.94648016852722");
+    TEST_NUMBER(-0.12345678901234568, "-0.12345678901234568");
+    TEST_NUMBER(1.2345678901234567e-60, "1.2345678901234567e-60");
+    TEST_NUMBER(9.8765432109876543e+45, "9.8765432109876543e+45");
+    TEST_NUMBER(9007199254740992.0, "9007199254740993.0"); /* halfway */
+    TEST_NUMBER(18014398509481984.0, "18014398509481986.0");
+    TEST_NUMBER(18014398509481992.0, "18014398509481990.0");
+    TEST_NUMBER(18014398509481988.0, "18014398509481987.0");
+    TEST_NUMBER(1.8446744073709552e+19, "18446744073709551615.0");
+}
+
+#define TEST_INT64(expect, json)\
+    do {\
+        lept_value v;\
+        lept_init(&v);\
+        EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&v, json));\
+        EXPECT_EQ_INT(LEPT_NUMBER, lept_get_type(&v));\
+        EXPECT_TRUE(lept_is_int64(&v));\
+        EXPECT_TRUE((expect) == lept_get_int64(&v));\
+        lept_free(&v);\
+    } while(0)
+
+static void test_parse_int64() {
+    const lept_int64 max = ((lept_int64)1 << 62) - 1 + ((lept_int64)1 << 62);
+    lept_value v;
+    TEST_INT64(0, "0");
+    TEST_INT64(1, "1");
+    TEST_INT64(-1, "-1");
+    TEST_INT64(((lept_int64)1 << 53) + 1, "9007199254740993"); /* not representable in double */
+    TEST_INT64(max, "9223372036854775807");
+    TEST_INT64(-max, "-9223372036854775807");
+    TEST_INT64(-max - 1, "-9223372036854775808");
+
+    /* -0, fraction, exponent and out of range stay double */
+    lept_init(&v);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&v, "-0"));
+    EXPECT_FALSE(lept_is_int64(&v));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&v, "1.0"));
+    EXPECT_FALSE(lept_is_int64(&v));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&v, "1e2"));
+    EXPECT_FALSE(lept_is_int64(&v));
+    EXPECT_TRUE(100 == lept_get_int64(&v));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&v, "9223372036854775808"));
+    EXPECT_FALSE(lept_is_int64(&v));
+    EXPECT_EQ_DOUBLE(9223372036854775808.0, lept_get_number(&v));
+    EXPECT_TRUE(max == lept_get_int64(&v));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&v, "-9223372036854775809"));
+    EXPECT_FALSE(lept_is_int64(&v));
+    EXPECT_TRUE(-max - 1 == lept_get_int64(&v));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&v, "12345678901234567890123"));
+    EXPECT_FALSE(lept_is_int64(&v));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&v, "-1e300"));
+    EXPECT_TRUE(-max - 1 == lept_get_int64(&v));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&v, "-2.5"));
+    EXPECT_TRUE(-2 == lept_get_int64(&v));
+    lept_free(&v);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_flags(&v, "1e300", 5, LEPT_PARSE_LAZY_NUMBER_FLAG));
+    EXPECT_TRUE(max == lept_get_int64(&v));
+    lept_free(&v);
 }
 
 #define TEST_STRING(expect, json)\
@@ -125,6 +203,41 @@ static void test_parse_string() {
     TEST_STRING("\xE2\x82\xAC", "\"\\u20AC\""); /* Euro sign U+20AC */
     TEST_STRING("\xF0\x9D\x84\x9E", "\"\\uD834\\uDD1E\"");  /* G clef sign U+1D11E */
     TEST_STRING("\xF0\x9D\x84\x9E", "\"\\ud834\\udd1e\"");  /* G clef sign U+1D11E */
+    TEST_STRING("\xE2\x82\xAC\x7F\xFF", "\"\xE2\x82\xAC\x7F\xFF\"");   /* bytes >= 0x7F are not control characters */
+}
+
+static void test_parse_long_string() {
+    static const char text[] = "The quick brown fox jumps over the lazy dog. ";
+    char json[256], expect[256];
+    size_t n, i;
+    lept_value v;
+    for (n = 0; n < 100; n++) {
+        char* p = json;
+        *p++ = '"';
+        for (i = 0; i < n; i++)
+            *p++ = expect[i] = text[i % (sizeof(text) - 1)];
+        *p++ = '\\';
+        *p++ = 'n';
+        expect[n] = '\n';
+        for (i = 0; i < n; i++)
+            *p++ = expect[n + 1 + i] = text[(i + 7) % (sizeof(text) - 1)];
+        *p++ = '"';
+        *p = '\0';
+        lept_init(&v);
+        EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&v, json));
+        EXPECT_EQ_INT(LEPT_STRING, lept_get_type(&v));
+        EXPECT_EQ_SIZE_T(2 * n + 1, lept_get_string_length(&v));
+        EXPECT_TRUE(memcmp(expect, lept_get_string(&v), 2 * n + 1) == 0);
+        lept_free(&v);
+        /* the same run without the escape is referenced without copying to the stack */
+        json[n + 1] = '"';
+        json[n + 2] = '\0';
+        lept_init(&v);
+        EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&v, json));
+        EXPECT_EQ_SIZE_T(n, lept_get_string_length(&v));
+        EXPECT_TRUE(memcmp(expect, lept_get_string(&v), n) == 0);
+        lept_free(&v);
+    }
 }
 
 static void test_parse_array() {
@@ -226,6 +339,853 @@ static void test_parse_object() {
     lept_free(&v);
 }
 
+static void test_parse_whitespace() {
+    static const char ws[] = " \t\n\r";
+    char json[256];
+    size_t n, i, j;
+    lept_value v;
+    for (n = 0; n < 40; n++) {
+        char* p = json;
+        for (i = 0; i < n; i++)
+            *p++ = ws[i % 4];
+        *p++ = '[';
+        for (j = 0; j < 2; j++) {
+            for (i = 0; i < n; i++)
+                *p++ = ws[(i + j) % 4];
+            *p++ = j == 0 ? '1' : ']';
+        }
+        for (i = 0; i < n; i++)
+            *p++ = ws[(i + 3) % 4];
+        *p = '\0';
+        lept_init(&v);
+        EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&v, json));
+        EXPECT_EQ_INT(LEPT_ARRAY, lept_get_type(&v));
+        EXPECT_EQ_SIZE_T(1, lept_get_array_size(&v));
+        lept_free(&v);
+    }
+}
+
+static void test_parse_insitu() {
+    char json[] = "{ \"a\" : \"x\\ny\", \"b\\u00A2\" : [ \"\", \"\\u20AC\", \"plain\" ] }!";
+    char error[] = "{ \"a\" : \"b\", \"c\" : [ \"d\" }";
+    const char* s;
+    lept_value v, *a;
+
+    lept_init(&v);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_insitu(&v, json, sizeof(json) - 2));
+    EXPECT_EQ_INT(LEPT_OBJECT, lept_get_type(&v));
+    EXPECT_EQ_SIZE_T(2, lept_get_object_size(&v));
+    EXPECT_EQ_STRING("a", lept_get_object_key(&v, 0), lept_get_object_key_length(&v, 0));
+    EXPECT_EQ_STRING("x\ny", lept_get_string(lept_get_object_value(&v, 0)), lept_get_string_length(lept_get_object_value(&v, 0)));
+    EXPECT_EQ_STRING("b\xC2\xA2", lept_get_object_key(&v, 1), lept_get_object_key_length(&v, 1));
+    a = lept_get_object_value(&v, 1);
+    EXPECT_EQ_SIZE_T(3, lept_get_array_size(a));
+    EXPECT_EQ_STRING("", lept_get_string(lept_get_array_element(a, 0)), lept_get_string_length(lept_get_array_element(a, 0)));
+    EXPECT_EQ_STRING("\xE2\x82\xAC", lept_get_string(lept_get_array_element(a, 1)), lept_get_string_length(lept_get_array_element(a, 1)));
+    s = lept_get_string(lept_get_array_element(a, 2));
+    EXPECT_EQ_STRING("plain", s, lept_get_string_length(lept_get_array_element(a, 2)));
+    EXPECT_TRUE(s > json && s < json + sizeof(json));
+    s = lept_get_object_key(&v, 1);
+    EXPECT_TRUE(s > json && s < json + sizeof(json));
+    lept_set_string(lept_get_array_element(a, 2), "copy", 4);
+    EXPECT_EQ_STRING("copy", lept_get_string(lept_get_array_element(a, 2)), lept_get_string_length(lept_get_array_element(a, 2)));
+    lept_free(&v);
+
+    lept_init(&v);
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, lept_parse_insitu(&v, error, sizeof(error) - 1));
+    EXPECT_EQ_INT(LEPT_NULL, lept_get_type(&v));
+    lept_free(&v);
+}
+
+static void test_parse_n() {
+    static const char json[] = "[1,\"abc\",true]{}nulltrue\"\\u0041\"-12.5e+1garbage";
+    lept_value v;
+
+    lept_init(&v);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_n(&v, json, 14));
+    EXPECT_EQ_INT(LEPT_ARRAY, lept_get_type(&v));
+    EXPECT_EQ_SIZE_T(3, lept_get_array_size(&v));
+    lept_free(&v);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_n(&v, json + 14, 2));
+    EXPECT_EQ_INT(LEPT_OBJECT, lept_get_type(&v));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_n(&v, json + 16, 4));
+    EXPECT_EQ_INT(LEPT_NULL, lept_get_type(&v));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_n(&v, json + 20, 4));
+    EXPECT_EQ_INT(LEPT_TRUE, lept_get_type(&v));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_n(&v, json + 24, 8));
+    EXPECT_EQ_STRING("A", lept_get_string(&v), lept_get_string_length(&v));
+    lept_free(&v);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_n(&v, json + 32, 8));
+    EXPECT_EQ_DOUBLE(-125.0, lept_get_number(&v));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_n(&v, json + 32, 3));
+    EXPECT_EQ_DOUBLE(-12.0, lept_get_number(&v));
+
+    /* every token cut short by the length */
+    EXPECT_EQ_INT(LEPT_PARSE_EXPECT_VALUE, lept_parse_n(&v, json, 0));
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, lept_parse_n(&v, json, 13));
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET, lept_parse_n(&v, "{\"a\":1}", 6));
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_COLON, lept_parse_n(&v, "{\"a\":1}", 4));
+    EXPECT_EQ_INT(LEPT_PARSE_INVALID_VALUE, lept_parse_n(&v, json + 16, 3));
+    EXPECT_EQ_INT(LEPT_PARSE_INVALID_VALUE, lept_parse_n(&v, json + 32, 4));
+    EXPECT_EQ_INT(LEPT_PARSE_INVALID_VALUE, lept_parse_n(&v, json + 32, 6));
+    EXPECT_EQ_INT(LEPT_PARSE_INVALID_VALUE, lept_parse_n(&v, json + 32, 1));
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_QUOTATION_MARK, lept_parse_n(&v, json + 24, 1));
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_QUOTATION_MARK, lept_parse_n(&v, json + 24, 2));
+    EXPECT_EQ_INT(LEPT_PARSE_INVALID_UNICODE_HEX, lept_parse_n(&v, json + 24, 6));
+    EXPECT_EQ_INT(LEPT_PARSE_INVALID_UNICODE_SURROGATE, lept_parse_n(&v, "\"\\uD834\\uDD1E\"", 8));
+    EXPECT_EQ_INT(LEPT_PARSE_ROOT_NOT_SINGULAR, lept_parse_n(&v, json + 14, 6));
+    EXPECT_EQ_INT(LEPT_PARSE_INVALID_STRING_CHAR, lept_parse_n(&v, "\"a\0b\"", 5));
+    EXPECT_EQ_INT(LEPT_NULL, lept_get_type(&v));
+    lept_free(&v);
+}
+
+/* Feeds json in chunks of every size and checks the result against lept_parse() */
+static void test_parse_push_chunks(lept_parser* p, const char* json) {
+    size_t len = strlen(json), n, i;
+    lept_value expect, v;
+    char* s1, *s2;
+    int ret;
+    lept_init(&expect);
+    ret = lept_parse(&expect, json);
+    s1 = ret == LEPT_PARSE_OK ? lept_stringify(&expect, NULL) : NULL;
+    for (n = 1; n <= len; n++) {
+        int fed = LEPT_PARSE_OK;
+        for (i = 0; i < len && fed == LEPT_PARSE_OK; i += n)
+            fed = lept_parser_feed(p, json + i, len - i < n ? len - i : n);
+        EXPECT_EQ_INT(ret, lept_parser_finish(p, &v));
+        if (ret == LEPT_PARSE_OK) {
+            s2 = lept_stringify(&v, NULL);
+            EXPECT_EQ_BASE(strcmp(s1, s2) == 0, s1, s2, "%s");
+            free(s2);
+        }
+        else
+            EXPECT_EQ_INT(LEPT_NULL, lept_get_type(&v));
+        lept_free(&v);
+    }
+    free(s1);
+    lept_free(&expect);
+}
+
+static void test_parse_push() {
+    lept_parser* p = lept_parser_create();
+    lept_value v;
+    char* big;
+    size_t i;
+
+    test_parse_push_chunks(p, " { \"n\" : null , \"f\" : false , \"t\" : true , \"i\" : 123 , \"d\" : -1.5e-3 , "
+        "\"s\" : \"a\\\"b\\\\c\\u20AC\\uD834\\uDD1E\" , \"a\" : [ 1, [ ], [ [ 2 ] ], { } ] , \"o\" : { \"1\" : 1, \"2\" : { \"3\" : [ 3 ] } } } ");
+    test_parse_push_chunks(p, "[]");
+    test_parse_push_chunks(p, "1");
+    test_parse_push_chunks(p, "12345");
+    test_parse_push_chunks(p, "\"\"");
+    test_parse_push_chunks(p, "[\"a\\\\\\\\\\\"b\\\\\", -123.5e-7]");
+
+    test_parse_push_chunks(p, "");
+    test_parse_push_chunks(p, "  ");
+    test_parse_push_chunks(p, "nul");
+    test_parse_push_chunks(p, "nulx");
+    test_parse_push_chunks(p, "1.");
+    test_parse_push_chunks(p, "1e309");
+    test_parse_push_chunks(p, "null x");
+    test_parse_push_chunks(p, "[1,]");
+    test_parse_push_chunks(p, "[1 2]");
+    test_parse_push_chunks(p, "[[[1]]");
+    test_parse_push_chunks(p, "{\"a\":[1,{\"b\":2}]");
+    test_parse_push_chunks(p, "{\"a\" 1}");
+    test_parse_push_chunks(p, "{\"a\":1,}");
+    test_parse_push_chunks(p, "{\"a\":");
+    test_parse_push_chunks(p, "[\"abc");
+    test_parse_push_chunks(p, "[\"\\x\"]");
+    test_parse_push_chunks(p, "[\"\\uD800\\uE000\"]");
+    test_parse_push_chunks(p, "[\"\\u12\"]");
+
+    /* feeding stops at the first error, finish() reports it and the parser starts over */
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, lept_parser_feed(p, "[1}", 3));
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, lept_parser_feed(p, "]", 1));
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, lept_parser_finish(p, &v));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parser_feed(p, "tr", 2));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parser_feed(p, "ue", 2));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parser_finish(p, &v));
+    EXPECT_EQ_INT(LEPT_TRUE, lept_get_type(&v));
+    lept_free(&v);
+
+    /* nothing but whitespace after the root, a NUL is not the end of the input */
+    EXPECT_EQ_INT(LEPT_PARSE_ROOT_NOT_SINGULAR, lept_parser_parse(p, &v, "1\0", 2));
+    EXPECT_EQ_INT(LEPT_PARSE_ROOT_NOT_SINGULAR, lept_parser_feed(p, "[1]\0\0", 5));
+    EXPECT_EQ_INT(LEPT_PARSE_ROOT_NOT_SINGULAR, lept_parser_finish(p, &v));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parser_feed(p, "[1]", 3));
+    EXPECT_EQ_INT(LEPT_PARSE_ROOT_NOT_SINGULAR, lept_parser_feed(p, "\0", 1));
+    EXPECT_EQ_INT(LEPT_PARSE_ROOT_NOT_SINGULAR, lept_parser_finish(p, &v));
+
+    /* a long string fed in small chunks */
+    big = (char*)malloc(1 << 20);
+    memset(big, 'a', 1 << 20);
+    big[0] = '"';
+    big[1000] = big[1001] = '\\';
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parser_feed(p, "[", 1));
+    for (i = 0; i < 1 << 20; i += 4096)
+        EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parser_feed(p, big + i, 4096));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parser_feed(p, "\"]", 2));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parser_finish(p, &v));
+    EXPECT_EQ_SIZE_T((1 << 20) - 2, lept_get_string_length(lept_get_array_element(&v, 0)));
+    lept_free(&v);
+    free(big);
+
+    /* a parser destroyed in the middle of a document frees it */
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parser_feed(p, "{\"a\":[\"b\",{\"c\":", 15));
+    lept_parser_destroy(p);
+}
+
+/* records events as text, stops when the log reaches the limit */
+typedef struct {
+    char log[256];
+    size_t len, limit;
+}test_sax_log;
+
+static int test_sax_append(void* user, const char* s, size_t len) {
+    test_sax_log* l = (test_sax_log*)user;
+    memcpy(l->log + l->len, s, len);
+    l->log[l->len += len] = '\0';
+    return l->len < l->limit;
+}
+
+static int test_sax_null(void* user) { return test_sax_append(user, "n ", 2); }
+static int test_sax_boolean(void* user, int b) { return test_sax_append(user, b ? "t " : "f ", 2); }
+static int test_sax_start_object(void* user) { return test_sax_append(user, "{ ", 2); }
+static int test_sax_start_array(void* user) { return test_sax_append(user, "[ ", 2); }
+
+static int test_sax_number(void* user, double n) {
+    char buf[32];
+    sprintf(buf, "d%g ", n);
+    return test_sax_append(user, buf, strlen(buf));
+}
+
+static int test_sax_int64(void* user, lept_int64 i) {
+    char buf[32];
+    sprintf(buf, "i%ld ", (long)i);
+    return test_sax_append(user, buf, strlen(buf));
+}
+
+static int test_sax_string(void* user, const char* s, size_t len) {
+    return test_sax_append(user, "s", 1) && test_sax_append(user, s, len) && test_sax_append(user, " ", 1);
+}
+
+static int test_sax_key(void* user, const char* k, size_t klen) {
+    return test_sax_append(user, "k", 1) && test_sax_append(user, k, klen) && test_sax_append(user, " ", 1);
+}
+
+static int test_sax_end_object(void* user, size_t size) {
+    char buf[32];
+    sprintf(buf, "}%d ", (int)size);
+    return test_sax_append(user, buf, strlen(buf));
+}
+
+static int test_sax_end_array(void* user, size_t size) {
+    char buf[32];
+    sprintf(buf, "]%d ", (int)size);
+    return test_sax_append(user, buf, strlen(buf));
+}
+
+#define TEST_SAX(expect, error, json, h, stop)\
+    do {\
+        test_sax_log l;\
+        l.log[0] = '\0';\
+        l.len = 0;\
+        l.limit = stop;\
+        EXPECT_EQ_INT(error, lept_parse_sax(json, strlen(json), &h, &l));\
+        EXPECT_EQ_BASE(strcmp(expect, l.log) == 0, expect, l.log, "%s");\
+    } while(0)
+
+static void test_parse_sax() {
+    lept_handler h = {
+        test_sax_null, test_sax_boolean, test_sax_number, test_sax_int64, test_sax_string,
+        test_sax_start_object, test_sax_key, test_sax_end_object, test_sax_start_array, test_sax_end_array
+    };
+    lept_handler partial = { NULL };
+
+    TEST_SAX("n ", LEPT_PARSE_OK, " null ", h, 255);
+    TEST_SAX("{ ka [ n f t i123 d-1.5 sabc sx\"y ]7 ko { }0 }2 ",
+        LEPT_PARSE_OK, "{ \"a\" : [ null, false, true, 123, -1.5, \"abc\", \"x\\\"y\" ], \"o\" : { } }", h, 255);
+    TEST_SAX("[ [ ]0 [ i1 ]1 ]2 ", LEPT_PARSE_OK, "[[],[1]]", h, 255);
+
+    /* events already delivered stay delivered when an error follows */
+    TEST_SAX("[ i1 ", LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, "[1}", h, 255);
+    TEST_SAX("{ ", LEPT_PARSE_MISS_KEY, "{1:2}", h, 255);
+    TEST_SAX("n ", LEPT_PARSE_ROOT_NOT_SINGULAR, "null x", h, 255);
+    TEST_SAX("", LEPT_PARSE_INVALID_STRING_ESCAPE, "\"\\v\"", h, 255);
+
+    /* a callback returning 0 stops the parse */
+    TEST_SAX("[ i1 ", LEPT_PARSE_TERMINATED, "[1,2,3]", h, 5);
+    TEST_SAX("{ ka ", LEPT_PARSE_TERMINATED, "{\"a\":1}", h, 5);
+
+    /* only integers and strings are seen, integers arrive as doubles */
+    partial.on_number = test_sax_number;
+    partial.on_string = test_sax_string;
+    TEST_SAX("d1 sb d2.5 ", LEPT_PARSE_OK, "[1,{\"a\":\"b\"},null,2.5]", partial, 255);
+}
+
+static void test_parse_iter() {
+    const char* json = " { \"id\" : 7, \"name\" : \"a\\\"b\", \"tags\" : [ \"x\", { \"y\" : [ 1, \"]\" ] }, true ], "
+        "\"score\" : -1.5, \"\\u0061k\" : false, \"nested\" : { \"deep\" : [ [ ] ] } } ";
+    lept_iter doc, o, a, it;
+    lept_value v;
+    double n;
+    int b;
+
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_iter_init(&doc, json, strlen(json)));
+    EXPECT_EQ_INT(LEPT_OBJECT, lept_iter_get_type(&doc));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_iter_get_object(&doc, &o));
+
+    /* forward, then wrapping around to an earlier field */
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_iter_find_field(&o, "score", 5, &it));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_iter_get_double(&it, &n));
+    EXPECT_EQ_DOUBLE(-1.5, n);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_iter_find_field(&o, "id", 2, &it));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_iter_get_double(&it, &n));
+    EXPECT_EQ_DOUBLE(7.0, n);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_iter_find_field(&o, "name", 4, &it));
+    EXPECT_EQ_INT(LEPT_STRING, lept_iter_get_type(&it));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_iter_get_value(&it, &v));
+    EXPECT_EQ_STRING("a\"b", lept_get_string(&v), lept_get_string_length(&v));
+    lept_free(&v);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_iter_find_field(&o, "ak", 2, &it));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_iter_get_boolean(&it, &b));
+    EXPECT_FALSE(b);
+    EXPECT_EQ_INT(LEPT_ITER_END, lept_iter_find_field(&o, "missing", 7, &it));
+    EXPECT_EQ_INT(LEPT_ITER_END, lept_iter_find_field(&o, "i", 1, &it));
+
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_iter_find_field(&o, "tags", 4, &it));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_iter_get_array(&it, &a));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_iter_next_element(&a, &it));
+    EXPECT_EQ_INT(LEPT_STRING, lept_iter_get_type(&it));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_iter_next_element(&a, &it));
+    EXPECT_EQ_INT(LEPT_OBJECT, lept_iter_get_type(&it));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_iter_next_element(&a, &it));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_iter_get_boolean(&it, &b));
+    EXPECT_TRUE(b);
+    EXPECT_EQ_INT(LEPT_ITER_END, lept_iter_next_element(&a, &it));
+    EXPECT_EQ_INT(LEPT_ITER_END, lept_iter_next_element(&a, &it));
+
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_iter_find_field(&o, "nested", 6, &it));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_iter_get_value(&it, &v));
+    EXPECT_EQ_SIZE_T(1, lept_get_object_size(&v));
+    lept_free(&v);
+
+    /* an empty container */
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_iter_init(&doc, "[ ]", 3));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_iter_get_array(&doc, &a));
+    EXPECT_EQ_INT(LEPT_ITER_END, lept_iter_next_element(&a, &it));
+
+    /* errors surface only when the broken part is reached */
+    EXPECT_EQ_INT(LEPT_PARSE_EXPECT_VALUE, lept_iter_init(&doc, "  ", 2));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_iter_init(&doc, "{\"a\":1,\"b\":[1,2", 15));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_iter_get_object(&doc, &o));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_iter_find_field(&o, "a", 1, &it));
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, lept_iter_find_field(&o, "c", 1, &it));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_iter_init(&doc, "{\"a\" 1}", 7));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_iter_get_object(&doc, &o));
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_COLON, lept_iter_find_field(&o, "a", 1, &it));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_iter_init(&doc, "{\"a\":1 \"b\":2}", 13));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_iter_get_object(&doc, &o));
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET, lept_iter_find_field(&o, "b", 1, &it));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_iter_init(&doc, "{\"a\":\"x}", 8));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_iter_get_object(&doc, &o));
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_QUOTATION_MARK, lept_iter_find_field(&o, "a", 1, &it));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_iter_init(&doc, "[1e309]", 7));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_iter_get_array(&doc, &a));
+    EXPECT_EQ_INT(LEPT_PARSE_NUMBER_TOO_BIG, lept_iter_next_element(&a, &it));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_iter_init(&doc, "[1, ]", 5));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_iter_get_array(&doc, &a));
+    EXPECT_EQ_INT(LEPT_PARSE_INVALID_VALUE, lept_iter_next_element(&a, &it));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_iter_init(&doc, "{\"a\":1, }", 10));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_iter_get_object(&doc, &o));
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_KEY, lept_iter_find_field(&o, "a", 1, &it));
+}
+
+/* checks the tape value at i against the DOM and returns the index after it */
+static size_t test_tape_value(const lept_tape* t, size_t i, const lept_value* v) {
+    size_t j, k;
+    EXPECT_EQ_INT(lept_get_type(v), lept_tape_get_type(t, i));
+    switch (lept_get_type(v)) {
+        case LEPT_NUMBER:
+            EXPECT_EQ_DOUBLE(lept_get_number(v), lept_tape_get_number(t, i));
+            EXPECT_EQ_INT(lept_is_int64(v), lept_tape_is_int64(t, i));
+            EXPECT_TRUE(lept_get_int64(v) == lept_tape_get_int64(t, i));
+            break;
+        case LEPT_STRING:
+            EXPECT_EQ_SIZE_T(lept_get_string_length(v), lept_tape_get_string_length(t, i));
+            EXPECT_TRUE(memcmp(lept_get_string(v), lept_tape_get_string(t, i), lept_get_string_length(v) + 1) == 0);
+            break;
+        case LEPT_ARRAY:
+            EXPECT_EQ_SIZE_T(lept_get_array_size(v), lept_tape_get_array_size(t, i));
+            for (j = 0, k = i + 2; j < lept_get_array_size(v); j++) {
+                EXPECT_EQ_SIZE_T(k, lept_tape_get_array_element(t, i, j));
+                k = test_tape_value(t, k, lept_get_array_element(v, j));
+            }
+            break;
+        case LEPT_OBJECT:
+            EXPECT_EQ_SIZE_T(lept_get_object_size(v), lept_tape_get_object_size(t, i));
+            for (j = 0, k = i + 2; j < lept_get_object_size(v); j++, k = lept_tape_next(t, k + 2)) {
+                EXPECT_EQ_SIZE_T(k + 2, lept_tape_get_object_value(t, i, j));
+                EXPECT_EQ_SIZE_T(lept_get_object_key_length(v, j), lept_tape_get_object_key_length(t, i, j));
+                EXPECT_TRUE(memcmp(lept_get_object_key(v, j), lept_tape_get_object_key(t, i, j), lept_get_object_key_length(v, j) + 1) == 0);
+                test_tape_value(t, lept_tape_get_object_value(t, i, j), lept_get_object_value(v, j));
+            }
+            break;
+        default:
+            break;
+    }
+    return lept_tape_next(t, i);
+}
+
+#define TEST_TAPE(json)\
+    do {\
+        lept_tape t;\
+        lept_value v;\
+        lept_init(&v);\
+        EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&v, json));\
+        EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_tape(&t, json, strlen(json)));\
+        EXPECT_EQ_SIZE_T(t.size, test_tape_value(&t, 0, &v));\
+        lept_free_tape(&t);\
+        lept_free(&v);\
+    } while(0)
+
+static void test_parse_tape() {
+    lept_tape t;
+    TEST_TAPE("null");
+    TEST_TAPE("-1.5e-3");
+    TEST_TAPE("9223372036854775807");
+    TEST_TAPE("-9223372036854775808");
+    TEST_TAPE("[9007199254740993, 1e300]");
+    TEST_TAPE("\"\"");
+    TEST_TAPE("\"Hello\\u0000World\"");
+    TEST_TAPE("[ ]");
+    TEST_TAPE("{ }");
+    TEST_TAPE("[ null , false , true , 123 , \"abc\", [ [ ], [ 1 ] ], { \"a\" : [ ] } ]");
+    TEST_TAPE(" { \"n\" : null , \"f\" : false , \"t\" : true , \"i\" : 123 , \"s\" : \"abc\", "
+        "\"a\" : [ 1, 2, 3 ], \"o\" : { \"1\" : 1, \"2\" : 2, \"3\" : { \"x\" : [ { } ] } } } ");
+
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET, lept_parse_tape(&t, "{\"a\":[1]", 8));
+    EXPECT_EQ_SIZE_T(0, t.size);
+    EXPECT_TRUE(t.words == NULL);
+    EXPECT_EQ_INT(LEPT_PARSE_ROOT_NOT_SINGULAR, lept_parse_tape(&t, "[] []", 5));
+    lept_free_tape(&t);
+}
+
+#define TEST_DOCUMENT(d, json)\
+    do {\
+        lept_value v;\
+        char* s1, *s2;\
+        lept_init(&v);\
+        EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&v, json));\
+        EXPECT_EQ_INT(LEPT_PARSE_OK, lept_document_parse(d, json, strlen(json)));\
+        s1 = lept_stringify(&v, NULL);\
+        s2 = lept_stringify(lept_document_root(d), NULL);\
+        EXPECT_EQ_BASE(strcmp(s1, s2) == 0, s1, s2, "%s");\
+        free(s1);\
+        free(s2);\
+        lept_free(&v);\
+    } while(0)
+
+static void test_parse_document() {
+    lept_document* d = lept_document_create();
+    char json[8192], *p = json;
+    lept_value v;
+    int i;
+
+    TEST_DOCUMENT(d, "null");
+    TEST_DOCUMENT(d, "\"Hello\\u0000World\"");
+    TEST_DOCUMENT(d, "[ null , false , true , 123 , \"abc\", [ [ ], [ 1 ] ], { \"a\" : [ ] } ]");
+    TEST_DOCUMENT(d, " { \"n\" : null , \"f\" : false , \"t\" : true , \"i\" : 123 , \"s\" : \"abc\", "
+        "\"a\" : [ 1, 2, 3 ], \"o\" : { \"1\" : 1, \"2\" : 2, \"3\" : { \"x\" : [ { } ] } } } ");
+
+    /* larger than one block */
+    *p++ = '[';
+    for (i = 0; i < 400; i++)
+        p += sprintf(p, "%s{\"k%d\":\"v%d\"}", i ? "," : "", i, i);
+    *p++ = ']';
+    *p = '\0';
+    TEST_DOCUMENT(d, json);
+    EXPECT_EQ_SIZE_T(400, lept_get_array_size(lept_document_root(d)));
+
+    /* errors leave nothing behind, and freeing a copy of arena values frees nothing */
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET, lept_document_parse(d, "[{\"a\":\"b\"", 10));
+    EXPECT_EQ_INT(LEPT_NULL, lept_get_type(lept_document_root(d)));
+    EXPECT_EQ_INT(LEPT_PARSE_ROOT_NOT_SINGULAR, lept_document_parse(d, "[\"a\"] x", 7));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_document_parse(d, "{\"a\":[\"b\"]}", 11));
+    v = *lept_document_root(d);
+    lept_free(&v);
+    EXPECT_EQ_SIZE_T(1, lept_get_object_size(lept_document_root(d)));
+    lept_document_destroy(d);
+}
+
+/* counts live blocks, and offsets them so that memory freed by the wrong allocator is caught */
+static void* test_count_alloc(void* user, size_t size) {
+    char* p = (char*)malloc(size + sizeof(double));
+    ++*(int*)user;
+    return p + sizeof(double);
+}
+
+static void* test_count_realloc(void* user, void* p, size_t size) {
+    if (p == NULL)
+        return test_count_alloc(user, size);
+    return (char*)realloc((char*)p - sizeof(double), size + sizeof(double)) + sizeof(double);
+}
+
+static void test_count_free(void* user, void* p) {
+    if (p != NULL) {
+        --*(int*)user;
+        free((char*)p - sizeof(double));
+    }
+}
+
+static void test_parse_allocator() {
+    const char* json = "{\"a\":[1,\"b\",{\"c\":null}],\"d\":\"e\"}";
+    int count = 0;
+    lept_allocator a;
+    lept_document* d;
+    lept_parser* p;
+    lept_value v, results[64];
+    const char* docs[64];
+    size_t lens[64];
+    const char* lazy = "[\"a string long enough to be lazy\",1.5]";
+    const char* path = "leptjson_test.json";
+    char buf[64], *s, *big, *big2;
+    FILE* f;
+    int i;
+    a.alloc = test_count_alloc;
+    a.realloc = test_count_realloc;
+    a.free = test_count_free;
+    a.user = &count;
+
+    lept_init(&v);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_with(&v, json, strlen(json), &a));
+    EXPECT_TRUE(count > 0);
+    s = lept_stringify_with(&v, NULL, &a);
+    EXPECT_EQ_BASE(strcmp(json, s) == 0, json, s, "%s");
+    test_count_free(&count, s);
+    lept_set_string_with(lept_get_array_element(lept_get_object_value(&v, 0), 1), "xyz", 3, &a);
+    lept_free_with(&v, &a);
+    EXPECT_EQ_INT(0, count);
+
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET, lept_parse_with(&v, "{\"a\":[\"b\"]", 10, &a));
+    EXPECT_EQ_INT(0, count);
+
+    p = lept_parser_create_with(&a);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parser_feed(p, json, 10));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parser_feed(p, json + 10, strlen(json) - 10));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parser_finish(p, &v));
+    lept_free_with(&v, &a);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parser_feed(p, json, 10));
+    lept_parser_destroy(p);
+    EXPECT_EQ_INT(0, count);
+
+    d = lept_document_create_with(&a);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_document_parse(d, json, strlen(json)));
+    EXPECT_EQ_SIZE_T(2, lept_get_object_size(lept_document_root(d)));
+    lept_document_destroy(d);
+    EXPECT_EQ_INT(0, count);
+
+    strcpy(buf, json);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_insitu_with(&v, buf, strlen(buf), &a));
+    EXPECT_EQ_STRING("e", lept_get_string(lept_get_object_value(&v, 1)), lept_get_string_length(lept_get_object_value(&v, 1)));
+    lept_free_with(&v, &a);
+    EXPECT_EQ_INT(0, count);
+
+    /* lazy strings would be copied with malloc() when read, so they are not lazy with an allocator */
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_flags_with(&v, lazy, strlen(lazy), LEPT_PARSE_LAZY_STRING_FLAG | LEPT_PARSE_LAZY_NUMBER_FLAG, &a));
+    EXPECT_EQ_STRING("a string long enough to be lazy", lept_get_string(lept_get_array_element(&v, 0)), lept_get_string_length(lept_get_array_element(&v, 0)));
+    EXPECT_EQ_DOUBLE(1.5, lept_get_number(lept_get_array_element(&v, 1)));
+    lept_free_with(&v, &a);
+    EXPECT_EQ_INT(0, count);
+
+    f = fopen(path, "wb");
+    fputs(json, f);
+    fclose(f);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_file_with(&v, path, LEPT_PARSE_DEFAULT_FLAG, &a));
+    EXPECT_EQ_SIZE_T(2, lept_get_object_size(&v));
+    lept_free_with(&v, &a);
+    EXPECT_EQ_INT(0, count);
+    remove(path);
+
+    /* a batch large enough for several threads calls the allocator, which is not thread-safe, from one only */
+    big = (char*)malloc(8192);
+    big2 = (char*)malloc(64 * 8192);
+    for (s = big, i = 0; i < 1000; i++)
+        s += sprintf(s, "%s\"%d\"", i ? "," : "[", i);
+    strcpy(s, "]");
+    for (i = 0; i < 64; i++) {
+        docs[i] = big;
+        lens[i] = strlen(big);
+    }
+    d = lept_document_create_with(&a);
+    EXPECT_EQ_SIZE_T(0, lept_parse_batch(d, docs, lens, 64, results, NULL, 4));
+    EXPECT_EQ_SIZE_T(1000, lept_get_array_size(&results[63]));
+    lept_document_destroy(d);
+    EXPECT_EQ_INT(0, count);
+
+    /* and so does a parallel parse of a large array */
+    for (s = big2, i = 0; i < 64; i++)
+        s += sprintf(s, "%s%s", i ? "," : "[", big);
+    strcpy(s, "]");
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_flags_with(&v, big2, strlen(big2), LEPT_PARSE_PARALLEL_FLAG | LEPT_PARSE_INDEX_FLAG, &a));
+    EXPECT_EQ_SIZE_T(64, lept_get_array_size(&v));
+    EXPECT_EQ_SIZE_T(1000, lept_get_array_size(lept_get_array_element(&v, 63)));
+    lept_free_with(&v, &a);
+    EXPECT_EQ_INT(0, count);
+    free(big2);
+    free(big);
+}
+
+static void test_parse_reuse() {
+    lept_parser* p = lept_parser_create();
+    const char* small = "[1,\"a\"]";
+    char json[2048], *q = json;
+    size_t size;
+    lept_value v;
+    int i;
+
+    EXPECT_EQ_SIZE_T(0, lept_parser_stack_size(p));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parser_parse(p, &v, small, strlen(small)));
+    EXPECT_EQ_SIZE_T(2, lept_get_array_size(&v));
+    lept_free(&v);
+    EXPECT_TRUE(lept_parser_stack_size(p) > 0);
+
+    /* the stack grows once for a deeper document and is kept for the next ones */
+    for (i = 0; i < 200; i++)
+        q += sprintf(q, "[%d,", i);
+    *q++ = '0';
+    for (i = 0; i < 200; i++)
+        *q++ = ']';
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parser_parse(p, &v, json, q - json));
+    lept_free(&v);
+    size = lept_parser_stack_size(p);
+    EXPECT_TRUE(size >= 200 * sizeof(lept_value));
+    for (i = 0; i < 10; i++) {
+        EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parser_parse(p, &v, json, q - json));
+        lept_free(&v);
+        EXPECT_EQ_SIZE_T(size, lept_parser_stack_size(p));
+    }
+
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, lept_parser_parse(p, &v, json, q - json - 1));
+    EXPECT_EQ_INT(LEPT_NULL, lept_get_type(&v));
+    EXPECT_EQ_INT(LEPT_PARSE_ROOT_NOT_SINGULAR, lept_parser_parse(p, &v, "[] 1", 4));
+
+    /* whole and fed documents share the parser */
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parser_feed(p, small, 3));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parser_feed(p, small + 3, strlen(small) - 3));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parser_finish(p, &v));
+    EXPECT_EQ_SIZE_T(2, lept_get_array_size(&v));
+    lept_free(&v);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parser_parse(p, &v, small, strlen(small)));
+    lept_free(&v);
+    lept_parser_destroy(p);
+}
+
+static void test_parse_depth() {
+    lept_parser* p = lept_parser_create();
+    size_t n = 100000, i;
+    char* json = (char*)malloc(n), *deep;
+    lept_value v;
+
+    /* far deeper than any recursion would survive */
+    memset(json, '[', n);
+    EXPECT_EQ_INT(LEPT_PARSE_EXPECT_VALUE, lept_parser_parse(p, &v, json, n));
+    for (i = 0; i < n; i += 5)
+        memcpy(json + i, "{\"a\":", 5);
+    EXPECT_EQ_INT(LEPT_PARSE_EXPECT_VALUE, lept_parser_parse(p, &v, json, n));
+
+    /* and freed without recursion either, whether parsing succeeds or fails after the root */
+    deep = (char*)malloc(7 * n + 1);
+    for (i = 0; i < n; i++) {
+        memcpy(deep + 5 * i, "{\"\":[", 5);
+        memcpy(deep + 5 * n + 2 * i, "]}", 2);
+    }
+    deep[7 * n] = 'x';
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parser_parse(p, &v, deep, 7 * n));
+    lept_free(&v);
+    EXPECT_EQ_INT(LEPT_PARSE_ROOT_NOT_SINGULAR, lept_parser_parse(p, &v, deep, 7 * n + 1));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parser_feed(p, deep, 7 * n));
+    lept_parser_destroy(p); /* with the whole document still in it */
+    p = lept_parser_create();
+    free(deep);
+
+    lept_parser_set_max_depth(p, 3);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parser_parse(p, &v, "[{\"a\":[1]},[]]", 14));
+    lept_free(&v);
+    EXPECT_EQ_INT(LEPT_PARSE_TOO_DEEP, lept_parser_parse(p, &v, "[{\"a\":[[]]}]", 12));
+    EXPECT_EQ_INT(LEPT_NULL, lept_get_type(&v));
+    EXPECT_EQ_INT(LEPT_PARSE_TOO_DEEP, lept_parser_parse(p, &v, json, n));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parser_feed(p, "[[[", 3));
+    EXPECT_EQ_INT(LEPT_PARSE_TOO_DEEP, lept_parser_feed(p, "{", 1));
+    EXPECT_EQ_INT(LEPT_PARSE_TOO_DEEP, lept_parser_finish(p, &v));
+    lept_parser_set_max_depth(p, 0);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parser_parse(p, &v, "[[[{}]]]", 8));
+    lept_free(&v);
+
+    free(json);
+    lept_parser_destroy(p);
+}
+
+static void test_parse_ndjson() {
+    size_t n = 20000, i, line, size = 64 * n;
+    char* json = (char*)malloc(size), *p = json;
+    lept_value v;
+
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_ndjson(&v, "1\n\n  \r\n[2]\r\n\"3\"", 15, 0, NULL));
+    EXPECT_EQ_INT(LEPT_ARRAY, lept_get_type(&v));
+    EXPECT_EQ_SIZE_T(3, lept_get_array_size(&v));
+    EXPECT_EQ_DOUBLE(1.0, lept_get_number(lept_get_array_element(&v, 0)));
+    EXPECT_EQ_INT(LEPT_ARRAY, lept_get_type(lept_get_array_element(&v, 1)));
+    EXPECT_EQ_INT(LEPT_STRING, lept_get_type(lept_get_array_element(&v, 2)));
+    lept_free(&v);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_ndjson(&v, "", 0, 0, NULL));
+    EXPECT_EQ_SIZE_T(0, lept_get_array_size(&v));
+    lept_free(&v);
+
+    /* large enough to be split over threads; every tenth line is blank */
+    for (i = 0; i < n; i++)
+        p += sprintf(p, i % 10 == 9 ? "\n" : "{\"id\":%d,\"s\":\"x\",\"a\":[true,null]}\n", (int)i);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_ndjson(&v, json, p - json, 4, NULL));
+    EXPECT_EQ_SIZE_T(n - n / 10, lept_get_array_size(&v));
+    for (i = 0; i < n - n / 10; i++) {
+        lept_value* e = lept_get_array_element(&v, i);
+        EXPECT_EQ_DOUBLE((double)(i + i / 9), lept_get_number(lept_get_object_value(e, 0)));
+    }
+    lept_free(&v);
+
+    /* the error reported is the first one in input order */
+    for (line = 0, p = json; line < n * 3 / 4; p++)
+        if (*p == '\n')
+            line++;
+    *p = '!';
+    p = strchr(json + 200, '\n') + 1;
+    *p = '?';
+    line = 0;
+    EXPECT_EQ_INT(LEPT_PARSE_INVALID_VALUE, lept_parse_ndjson(&v, json, strlen(json), 4, &line));
+    EXPECT_EQ_SIZE_T(7, line);
+    EXPECT_EQ_INT(LEPT_NULL, lept_get_type(&v));
+    *p = '{';
+    EXPECT_EQ_INT(LEPT_PARSE_INVALID_VALUE, lept_parse_ndjson(&v, json, strlen(json), 4, &line));
+    EXPECT_EQ_SIZE_T(n * 3 / 4, line);
+    free(json);
+}
+
+#define TEST_PARALLEL(error, json, len)\
+    do {\
+        lept_value v1, v2;\
+        char* s1, *s2;\
+        EXPECT_EQ_INT(error, lept_parse_n(&v1, json, len));\
+        EXPECT_EQ_INT(error, lept_parse_parallel(&v2, json, len, 4));\
+        s1 = lept_stringify(&v1, NULL);\
+        s2 = lept_stringify(&v2, NULL);\
+        EXPECT_EQ_BASE(strcmp(s1, s2) == 0, s1, s2, "%s");\
+        free(s1);\
+        free(s2);\
+        lept_free(&v1);\
+        lept_free(&v2);\
+    } while(0)
+
+static void test_parse_parallel() {
+    size_t n = 10000, i, size = 64 * n;
+    char* json = (char*)malloc(size), *p = json;
+
+    /* elements with commas, brackets and quotes inside, to be split only between them */
+    p += sprintf(p, " [ ");
+    for (i = 0; i < n; i++)
+        p += sprintf(p, i % 3 == 0 ? "%s{\"a\":[%d,\"],\\\",[\"]}" : i % 3 == 1 ? "%s\"x,y\\\\\"" : "%s[[%d],{}]",
+            i > 0 ? " , " : "", (int)i);
+    p += sprintf(p, " ] ");
+    TEST_PARALLEL(LEPT_PARSE_OK, json, p - json);
+    TEST_PARALLEL(LEPT_PARSE_OK, json, p - json - 1);
+    p[-1] = 'x';
+    TEST_PARALLEL(LEPT_PARSE_ROOT_NOT_SINGULAR, json, p - json);
+    p[-1] = ' ';
+    TEST_PARALLEL(LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, json, p - json - 3);
+    json[p - json - 3] = ',';
+    TEST_PARALLEL(LEPT_PARSE_INVALID_VALUE, json, p - json);
+    json[p - json - 3] = ']';
+    *strstr(json + (p - json) / 2, "x,y") = '\x01';
+    TEST_PARALLEL(LEPT_PARSE_INVALID_STRING_CHAR, json, p - json);
+
+    /* anything else, or too small to split */
+    TEST_PARALLEL(LEPT_PARSE_OK, "[1,2,3]", 7);
+    TEST_PARALLEL(LEPT_PARSE_OK, "{\"a\":1}", 7);
+    TEST_PARALLEL(LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, "[1,2", 4);
+    free(json);
+}
+
+static void test_parse_file() {
+    const char* path = "leptjson_test.json";
+    const char* json = " { \"a\" : [ 1, \"b\", null ], \"c\" : { } } ";
+    lept_value v;
+    char* s;
+    FILE* f;
+
+    f = fopen(path, "wb");
+    fputs(json, f);
+    fclose(f);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_file(&v, path, LEPT_PARSE_DEFAULT_FLAG));
+    s = lept_stringify(&v, NULL);
+    EXPECT_EQ_STRING("{\"a\":[1,\"b\",null],\"c\":{}}", s, strlen(s));
+    free(s);
+    lept_free(&v);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_file(&v, path, LEPT_PARSE_PARALLEL_FLAG));
+    EXPECT_EQ_SIZE_T(2, lept_get_object_size(&v));
+    lept_free(&v);
+
+    f = fopen(path, "wb");
+    fclose(f);
+    EXPECT_EQ_INT(LEPT_PARSE_EXPECT_VALUE, lept_parse_file(&v, path, LEPT_PARSE_DEFAULT_FLAG));
+    EXPECT_EQ_INT(LEPT_NULL, lept_get_type(&v));
+    remove(path);
+    EXPECT_EQ_INT(LEPT_PARSE_IO_ERROR, lept_parse_file(&v, path, LEPT_PARSE_DEFAULT_FLAG));
+    EXPECT_EQ_INT(LEPT_NULL, lept_get_type(&v));
+}
+
+static void test_parse_batch() {
+    size_t n = 5000, i, failed;
+    char* json = (char*)malloc(64 * n), *p = json;
+    const char** docs = (const char**)malloc(n * sizeof(char*));
+    size_t* lens = (size_t*)malloc(n * sizeof(size_t));
+    lept_value* results = (lept_value*)malloc(n * sizeof(lept_value));
+    int* errors = (int*)malloc(n * sizeof(int));
+    lept_document* d = lept_document_create();
+    int pass;
+
+    /* every hundredth document is broken */
+    for (i = 0; i < n; i++) {
+        docs[i] = p;
+        p += lens[i] = sprintf(p, i % 100 == 99 ? "{\"id\":%d,}" : "{\"id\":%d,\"tags\":[\"a\",\"b\"],\"ok\":true}", (int)i);
+    }
+    for (pass = 0; pass < 4; pass++) {
+        failed = lept_parse_batch(pass < 2 ? NULL : d, docs, lens, n, results, pass % 2 ? errors : NULL, 4);
+        EXPECT_EQ_SIZE_T(n / 100, failed);
+        for (i = 0; i < n; i++) {
+            if (i % 100 == 99) {
+                EXPECT_EQ_INT(LEPT_NULL, lept_get_type(&results[i]));
+                if (pass % 2)
+                    EXPECT_EQ_INT(LEPT_PARSE_MISS_KEY, errors[i]);
+            }
+            else {
+                EXPECT_EQ_DOUBLE((double)i, lept_get_number(lept_get_object_value(&results[i], 0)));
+                if (pass % 2)
+                    EXPECT_EQ_INT(LEPT_PARSE_OK, errors[i]);
+            }
+            if (pass < 2)
+                lept_free(&results[i]);
+        }
+    }
+    EXPECT_EQ_SIZE_T(0, lept_parse_batch(d, NULL, NULL, 0, NULL, NULL, 0));
+
+    lept_document_destroy(d);
+    free(errors);
+    free(results);
+    free(lens);
+    free(docs);
+    free(json);
+}
+
 #define TEST_PARSE_ERROR(error, json)\
     do {\
         lept_value v;\
@@ -262,6 +1222,8 @@ static void test_parse_invalid_value() {
 
 static void test_parse_root_not_singular() {
     TEST_PARSE_ERROR(LEPT_PARSE_ROOT_NOT_SINGULAR, "null x");
+    TEST_PARSE_ERROR(LEPT_PARSE_ROOT_NOT_SINGULAR, "null                                x");
+    TEST_PARSE_ERROR(LEPT_PARSE_ROOT_NOT_SINGULAR, "[\"a\"] x");
 
     /* invalid number */
     TEST_PARSE_ERROR(LEPT_PARSE_ROOT_NOT_SINGULAR, "0123"); /* after zero should be '.' or nothing */
@@ -272,11 +1234,14 @@ static void test_parse_root_not_singular() {
 static void test_parse_number_too_big() {
     TEST_PARSE_ERROR(LEPT_PARSE_NUMBER_TOO_BIG, "1e309");
     TEST_PARSE_ERROR(LEPT_PARSE_NUMBER_TOO_BIG, "-1e309");
+    TEST_PARSE_ERROR(LEPT_PARSE_NUMBER_TOO_BIG, "1.7976931348623159e+308");
+    TEST_PARSE_ERROR(LEPT_PARSE_NUMBER_TOO_BIG, "1e100000000000");
 }
 
 static void test_parse_miss_quotation_mark() {
     TEST_PARSE_ERROR(LEPT_PARSE_MISS_QUOTATION_MARK, "\"");
     TEST_PARSE_ERROR(LEPT_PARSE_MISS_QUOTATION_MARK, "\"abc");
+    TEST_PARSE_ERROR(LEPT_PARSE_MISS_QUOTATION_MARK, "\"abcdefghijklmnopqrstuvwxyz0123456789");
 }
 
 static void test_parse_invalid_string_escape() {
@@ -289,6 +1254,7 @@ static void test_parse_invalid_string_escape() {
 static void test_parse_invalid_string_char() {
     TEST_PARSE_ERROR(LEPT_PARSE_INVALID_STRING_CHAR, "\"\x01\"");
     TEST_PARSE_ERROR(LEPT_PARSE_INVALID_STRING_CHAR, "\"\x1F\"");
+    TEST_PARSE_ERROR(LEPT_PARSE_INVALID_STRING_CHAR, "\"abcdefghijklmnopqrstuvwxyz\x01\"");
 }
 
 static void test_parse_invalid_unicode_hex() {
@@ -345,14 +1311,195 @@ static void test_parse_miss_comma_or_curly_bracket() {
     TEST_PARSE_ERROR(LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET, "{\"a\":{}");
 }
 
+static void test_parse_keys() {
+    const char* json = "[{\"id\":1,\"name\":\"a\"},{\"name\":\"b\",\"id\":2},{\"id\":3,\"\":{\"id\":4}}]";
+    lept_keys* keys = lept_keys_create();
+    lept_parser* p = lept_parser_create();
+    lept_value v, w;
+    const char* id = lept_keys_intern(keys, "id", 2);
+
+    EXPECT_TRUE(id == lept_keys_intern(keys, "id", 2));
+    EXPECT_TRUE(id != lept_keys_intern(keys, "ids", 3));
+    EXPECT_EQ_SIZE_T(2, lept_keys_count(keys));
+
+    lept_parser_set_keys(p, keys);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parser_parse(p, &v, json, strlen(json)));
+    EXPECT_EQ_SIZE_T(4, lept_keys_count(keys));
+    EXPECT_TRUE(lept_get_object_key(lept_get_array_element(&v, 0), 0) == id);
+    EXPECT_TRUE(lept_get_object_key(lept_get_array_element(&v, 1), 1) == id);
+    EXPECT_TRUE(lept_get_object_key(lept_get_array_element(&v, 0), 1) == lept_get_object_key(lept_get_array_element(&v, 1), 0));
+    EXPECT_EQ_DOUBLE(4.0, lept_get_number(lept_find_object_value(lept_find_object_value(lept_get_array_element(&v, 2), "", 0), id, 2)));
+    EXPECT_TRUE(lept_find_object_value(lept_get_array_element(&v, 0), id, 1) == NULL); /* the same pointer, but "i" */
+
+    /* keys outlive the values, an error frees the members parsed so far */
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_COLON, lept_parser_parse(p, &w, "{\"id\":1,\"x\"}", 12));
+    EXPECT_EQ_SIZE_T(5, lept_keys_count(keys));
+    lept_free(&v);
+
+    lept_parser_set_keys(p, NULL);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parser_parse(p, &v, json, strlen(json)));
+    EXPECT_TRUE(lept_get_object_key(lept_get_array_element(&v, 0), 0) != id);
+    EXPECT_EQ_SIZE_T(5, lept_keys_count(keys));
+    lept_free(&v);
+
+    lept_parser_destroy(p);
+    lept_keys_destroy(keys);
+}
+
+static void test_parse_lazy() {
+    const char* json = "[1.5,-0,12345678901234567890,1e400,3,-2E-3]";
+    const char* text = "{\"name\":\"a long string without escapes!!\",\"esc\":\"tab\\there, long enough\",\"s\":\"short\"}";
+    char* big = (char*)malloc(100000), *p = big, *out;
+    lept_value v;
+    size_t i, len;
+    double sum = 0.0;
+
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_flags(&v, json, strlen(json), LEPT_PARSE_LAZY_NUMBER_FLAG));
+    out = lept_stringify(&v, &len);
+    EXPECT_EQ_SIZE_T(strlen(json), len);
+    EXPECT_TRUE(memcmp(json, out, len) == 0);
+    free(out);
+    EXPECT_EQ_DOUBLE(1.5, lept_get_number(lept_get_array_element(&v, 0)));
+    EXPECT_EQ_DOUBLE(-0.0, lept_get_number(lept_get_array_element(&v, 1)));
+    EXPECT_EQ_DOUBLE(12345678901234567890.0, lept_get_number(lept_get_array_element(&v, 2)));
+    EXPECT_EQ_DOUBLE(HUGE_VAL, lept_get_number(lept_get_array_element(&v, 3)));
+    EXPECT_TRUE(lept_is_int64(lept_get_array_element(&v, 4)));
+    EXPECT_TRUE(lept_get_int64(lept_get_array_element(&v, 4)) == 3);
+    EXPECT_EQ_DOUBLE(-0.002, lept_get_number(lept_get_array_element(&v, 5)));
+    out = lept_stringify(&v, &len);
+    EXPECT_EQ_STRING("[1.5,-0,1.2345678901234567e+19,1e400,3,-0.002]", out, len);
+    free(out);
+    lept_free(&v);
+
+    EXPECT_EQ_INT(LEPT_PARSE_NUMBER_TOO_BIG, lept_parse_flags(&v, "1e400", 5, LEPT_PARSE_DEFAULT_FLAG));
+    EXPECT_EQ_INT(LEPT_PARSE_INVALID_VALUE, lept_parse_flags(&v, "[1.]", 4, LEPT_PARSE_LAZY_NUMBER_FLAG));
+    EXPECT_EQ_INT(LEPT_PARSE_INVALID_VALUE, lept_parse_flags(&v, "{\"a\":-}", 7, LEPT_PARSE_LAZY_NUMBER_FLAG));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_flags(&v, "{\"a\":-1e-2}", 11, LEPT_PARSE_LAZY_NUMBER_FLAG));
+    EXPECT_EQ_DOUBLE(-0.01, lept_get_number(lept_get_object_value(&v, 0)));
+    lept_free(&v);
+
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_flags(&v, text, strlen(text), LEPT_PARSE_LAZY_STRING_FLAG));
+    out = lept_stringify(&v, &len);
+    EXPECT_EQ_SIZE_T(strlen(text), len);
+    EXPECT_TRUE(memcmp(text, out, len) == 0);
+    free(out);
+    EXPECT_EQ_SIZE_T(31, lept_get_string_length(lept_get_object_value(&v, 0)));
+    EXPECT_EQ_STRING("a long string without escapes!!", lept_get_string(lept_get_object_value(&v, 0)), 31);
+    EXPECT_EQ_STRING("tab\there, long enough", lept_get_string(lept_get_object_value(&v, 1)), lept_get_string_length(lept_get_object_value(&v, 1)));
+    EXPECT_EQ_STRING("short", lept_get_string(lept_get_object_value(&v, 2)), lept_get_string_length(lept_get_object_value(&v, 2)));
+    lept_free(&v);
+    EXPECT_EQ_INT(LEPT_PARSE_INVALID_STRING_CHAR, lept_parse_flags(&v, "[\"a long string with a\x01 control\"]", 33, LEPT_PARSE_LAZY_STRING_FLAG));
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_QUOTATION_MARK, lept_parse_flags(&v, "[\"a long string, unterminated", 29, LEPT_PARSE_LAZY_STRING_FLAG));
+
+    /* parallel parsing hands the flag to every part */
+    *p++ = '[';
+    for (i = 0; i < 10000; i++)
+        p += sprintf(p, "%u.5,", (unsigned)i);
+    strcpy(p - 1, "]");
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_flags(&v, big, strlen(big), LEPT_PARSE_PARALLEL_FLAG | LEPT_PARSE_LAZY_NUMBER_FLAG));
+    EXPECT_EQ_SIZE_T(10000, lept_get_array_size(&v));
+    for (i = 0; i < lept_get_array_size(&v); i++)
+        sum += lept_get_number(lept_get_array_element(&v, i));
+    EXPECT_EQ_DOUBLE(10000.0 * 9999 / 2 + 5000, sum);
+    out = lept_stringify(&v, &len);
+    EXPECT_EQ_SIZE_T(strlen(big), len);
+    free(out);
+    lept_free(&v);
+    free(big);
+}
+
+static void test_parse_index() {
+    static const char* docs[] = {
+        "[\"a\\\\\",\"b\\\"\",\"\\\\\\\\\\\"\",\"\\u00e9\\\\\"]",
+        "{\"k\" :  \"v\\n\" ,\n\t\"x\":[ true ,false,null,  -1.5e3 ],   \"\":{}}",
+        "[\"tab\there\"]",
+        "[\"unterminated",
+        "[1,    \x01 2]",
+        "[   \"a\"    x]",
+        "[    \"a\\x\"]",
+        "{\"a\"    \"b\"}",
+        "\"s\"     \"t\""
+    };
+    char* big = (char*)malloc(200000), *p;
+    lept_value v, w;
+    size_t i, n, len, vlen, wlen;
+    char* vout, *wout;
+
+    /* the same results as one pass, wherever the 64-byte blocks of the first pass split the input */
+    for (i = 0; i < sizeof(docs) / sizeof(docs[0]); i++)
+        for (n = 0; n <= 70; n++) {
+            int ret;
+            p = big;
+            memset(p, n % 2 ? ' ' : '\n', n);
+            strcpy(p + n, docs[i]);
+            len = strlen(big);
+            ret = lept_parse_n(&v, big, len);
+            EXPECT_EQ_INT(ret, lept_parse_flags(&w, big, len, LEPT_PARSE_INDEX_FLAG));
+            if (ret == LEPT_PARSE_OK) {
+                vout = lept_stringify(&v, &vlen);
+                wout = lept_stringify(&w, &wlen);
+                EXPECT_TRUE(vlen == wlen && memcmp(vout, wout, vlen) == 0);
+                free(vout);
+                free(wout);
+                lept_free(&v);
+                lept_free(&w);
+            }
+        }
+
+    /* strings and whitespace running across the chunks indexed at a time */
+    p = big;
+    *p++ = '[';
+    for (i = 0; i < 1000; i++) {
+        memset(p, ' ', i % 100);
+        p += i % 100;
+        p += sprintf(p, "\"%u%s\",", (unsigned)i, i % 3 ? "\\\\" : "\\\"");
+    }
+    *p++ = '\"';
+    memset(p, 'x', 40000);
+    p += 40000;
+    strcpy(p, "\\n\"]");
+    len = strlen(big);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_n(&v, big, len));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_flags(&w, big, len, LEPT_PARSE_INDEX_FLAG | LEPT_PARSE_LAZY_STRING_FLAG));
+    EXPECT_EQ_SIZE_T(1001, lept_get_array_size(&w));
+    vout = lept_stringify(&v, &vlen);
+    wout = lept_stringify(&w, &wlen);
+    EXPECT_TRUE(vlen == wlen && memcmp(vout, wout, vlen) == 0);
+    free(vout);
+    free(wout);
+    lept_free(&v);
+    lept_free(&w);
+    free(big);
+}
+
 static void test_parse() {
     test_parse_null();
     test_parse_true();
     test_parse_false();
     test_parse_number();
+    test_parse_int64();
     test_parse_string();
+    test_parse_long_string();
     test_parse_array();
     test_parse_object();
+    test_parse_whitespace();
+    test_parse_insitu();
+    test_parse_n();
+    test_parse_push();
+    test_parse_reuse();
+    test_parse_depth();
+    test_parse_sax();
+    test_parse_iter();
+    test_parse_tape();
+    test_parse_document();
+    test_parse_allocator();
+    test_parse_ndjson();
+    test_parse_parallel();
+    test_parse_file();
+    test_parse_batch();
+    test_parse_keys();
+    test_parse_lazy();
+    test_parse_index();
 
     test_parse_expect_value();
     test_parse_invalid_value();
@@ -403,6 +1550,10 @@ static void test_stringify_number() {
     TEST_ROUNDTRIP("-2.2250738585072014e-308");
     TEST_ROUNDTRIP("1.7976931348623157e+308");  /* Max double */
     TEST_ROUNDTRIP("-1.7976931348623157e+308");
+
+    TEST_ROUNDTRIP("9007199254740993");
+    TEST_ROUNDTRIP("9223372036854775807");
+    TEST_ROUNDTRIP("-9223372036854775808");
 }
 
 static void test_stringify_string() {
@@ -433,6 +1584,105 @@ static void test_stringify() {
     test_stringify_object();
 }
 
+static void test_access_find() {
+    char json[32768], key[16], *p = json;
+    lept_parser* parser = lept_parser_create();
+    lept_value v, *e;
+    int i, pass;
+
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&v, "{\"a\":1,\"b\":2,\"a\":3,\"\":4}"));
+    EXPECT_EQ_DOUBLE(1.0, lept_get_number(lept_find_object_value(&v, "a", 1)));
+    EXPECT_EQ_DOUBLE(2.0, lept_get_number(lept_find_object_value(&v, "b", 1)));
+    EXPECT_EQ_DOUBLE(4.0, lept_get_number(lept_find_object_value(&v, "", 0)));
+    EXPECT_TRUE(lept_find_object_value(&v, "c", 1) == NULL);
+    EXPECT_TRUE(lept_find_object_value(&v, "ab", 2) == NULL);
+    lept_free(&v);
+
+    /* large objects, from both parsers, are indexed; duplicates still give the first member */
+    *p++ = '{';
+    for (i = 0; i < 1000; i++)
+        p += sprintf(p, "\"k%d\":%d,", i, i);
+    strcpy(p, "\"k7\":-1}");
+    for (pass = 0; pass < 2; pass++) {
+        if (pass == 0)
+            EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&v, json));
+        else
+            EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parser_parse(parser, &v, json, strlen(json)));
+        for (i = 0; i < 1000; i++) {
+            sprintf(key, "k%d", i);
+            EXPECT_TRUE((e = lept_find_object_value(&v, key, strlen(key))) != NULL);
+            if (e != NULL)
+                EXPECT_EQ_DOUBLE((double)i, lept_get_number(e));
+        }
+        EXPECT_TRUE(lept_find_object_value(&v, "k1000", 5) == NULL);
+        EXPECT_TRUE(lept_find_object_value(&v, "k", 1) == NULL);
+        lept_free(&v);
+    }
+    lept_parser_destroy(parser);
+}
+
+static void test_access_layout() {
+#ifdef LEPT_COMPACT_VALUE
+    EXPECT_TRUE(sizeof(lept_value) <= 16);
+    EXPECT_TRUE(sizeof(lept_member) <= 32);
+#endif
+    EXPECT_TRUE(sizeof(lept_value) <= 24);
+}
+
+#define TEST_POINTER(expect, v, path)\
+    do {\
+        lept_pointer* p = lept_pointer_compile(path);\
+        EXPECT_TRUE(p != NULL);\
+        if (p != NULL) {\
+            EXPECT_TRUE(lept_pointer_get(v, p) == (expect));\
+            lept_pointer_free(p);\
+        }\
+    } while(0)
+
+static void test_access_pointer() {
+    const char* json = "{\"foo\":[\"bar\",\"baz\"],\"\":0,\"a/b\":1,\"c%d\":2,\"e^f\":3,\"g|h\":4,\"i\\\\j\":5,\"k\\\"l\":6,\" \":7,\"m~n\":8}";
+    lept_value v, w;
+    lept_value* foo;
+    lept_pointer* p;
+
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&v, json));
+    foo = lept_get_object_value(&v, 0);
+    TEST_POINTER(&v, &v, "");
+    TEST_POINTER(foo, &v, "/foo");
+    TEST_POINTER(lept_get_array_element(foo, 0), &v, "/foo/0");
+    TEST_POINTER(lept_get_array_element(foo, 1), &v, "/foo/1");
+    TEST_POINTER(lept_get_object_value(&v, 1), &v, "/");
+    TEST_POINTER(lept_get_object_value(&v, 2), &v, "/a~1b");
+    TEST_POINTER(lept_get_object_value(&v, 3), &v, "/c%d");
+    TEST_POINTER(lept_get_object_value(&v, 4), &v, "/e^f");
+    TEST_POINTER(lept_get_object_value(&v, 5), &v, "/g|h");
+    TEST_POINTER(lept_get_object_value(&v, 6), &v, "/i\\j");
+    TEST_POINTER(lept_get_object_value(&v, 7), &v, "/k\"l");
+    TEST_POINTER(lept_get_object_value(&v, 8), &v, "/ ");
+    TEST_POINTER(lept_get_object_value(&v, 9), &v, "/m~0n");
+    TEST_POINTER(NULL, &v, "/foo/2");
+    TEST_POINTER(NULL, &v, "/foo/-");
+    TEST_POINTER(NULL, &v, "/foo/01");
+    TEST_POINTER(NULL, &v, "/foo/bar");
+    TEST_POINTER(NULL, &v, "/foo/18446744073709551616");
+    TEST_POINTER(NULL, &v, "/foo/0/0");
+    TEST_POINTER(NULL, &v, "/a/b");
+    TEST_POINTER(NULL, &v, "/m~1n");
+    TEST_POINTER(NULL, &v, "//");
+    EXPECT_TRUE(lept_pointer_compile("foo") == NULL);
+    EXPECT_TRUE(lept_pointer_compile("/~2") == NULL);
+    EXPECT_TRUE(lept_pointer_compile("/a~") == NULL);
+
+    /* one compiled pointer, several documents */
+    p = lept_pointer_compile("/foo/1");
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&w, "{\"foo\":{\"1\":true}}"));
+    EXPECT_EQ_INT(LEPT_TRUE, lept_get_type(lept_pointer_get(&w, p)));
+    EXPECT_EQ_STRING("baz", lept_get_string(lept_pointer_get(&v, p)), lept_get_string_length(lept_pointer_get(&v, p)));
+    lept_pointer_free(p);
+    lept_free(&w);
+    lept_free(&v);
+}
+
 static void test_access_null() {
     lept_value v;
     lept_init(&v);
@@ -459,6 +1709,11 @@ static void test_access_number() {
     lept_set_string(&v, "a", 1);
     lept_set_number(&v, 1234.5);
     EXPECT_EQ_DOUBLE(1234.5, lept_get_number(&v));
+    EXPECT_FALSE(lept_is_int64(&v));
+    lept_set_int64(&v, -1234);
+    EXPECT_TRUE(lept_is_int64(&v));
+    EXPECT_TRUE(-1234 == lept_get_int64(&v));
+    EXPECT_EQ_DOUBLE(-1234.0, lept_get_number(&v));
     lept_free(&v);
 }
 
@@ -469,14 +1724,24 @@ static void test_access_string() {
     EXPECT_EQ_STRING("", lept_get_string(&v), lept_get_string_length(&v));
     lept_set_string(&v, "Hello", 5);
     EXPECT_EQ_STRING("Hello", lept_get_string(&v), lept_get_string_length(&v));
+    EXPECT_TRUE(lept_get_string(&v) >= (const char*)&v && lept_get_string(&v) < (const char*)(&v + 1));
+    lept_set_string(&v, "a\0b", 3);
+    EXPECT_EQ_STRING("a\0b", lept_get_string(&v), lept_get_string_length(&v));
+    lept_set_string(&v, "Hello, world! Hello, world!", 27);
+    EXPECT_EQ_STRING("Hello, world! Hello, world!", lept_get_string(&v), lept_get_string_length(&v));
+    lept_set_string(&v, "Hello, world!!!", 15);
+    EXPECT_EQ_STRING("Hello, world!!!", lept_get_string(&v), lept_get_string_length(&v));
     lept_free(&v);
 }
 
 static void test_access() {
+    test_access_layout();
     test_access_null();
     test_access_boolean();
     test_access_number();
     test_access_string();
+    test_access_find();
+    test_access_pointer();
 }
 
 int main() {